@@ -0,0 +1,746 @@
+// Headless physics benchmark. Builds scripted scenarios on top of the
+// physics module only and reports per-step timings, so engine changes can be
+// compared without opening a window.
+//
+//   physics_bench [--scenario all|tiles|falling|storm|pile|triggers|lod|
+//                 layers|resting] [--statics N] [--bodies M] [--steps S]
+//                 [--warmup W] [--workers K] [--seed X] [--format csv|json]
+//                 [--check-rollback] [--check-contacts]
+//
+// --check-rollback steps each scenario, rolls it back and steps it again,
+// and exits with 1 if the checksums or contact callbacks of the two runs
+// differ.
+//
+// --check-contacts lets the resting bodies fall asleep on the floor, wakes
+// them and makes them jump, and exits with 1 unless each reported exactly
+// one begin and, only once it jumped, one end.
+
+// clock_gettime is POSIX, not C99.
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "engine/types.h"
+#include "engine/util/util.h"
+#include "engine/physics/physics.h"
+
+// Counting allocations needs the glibc entry points to forward to; other
+// C libraries report -1.
+#if defined(__GLIBC__)
+#define BENCH_COUNT_ALLOCATIONS
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *pointer, size_t size);
+
+static u64 allocation_count;
+
+void *malloc(size_t size) {
+    __atomic_fetch_add(&allocation_count, 1, __ATOMIC_RELAXED);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    __atomic_fetch_add(&allocation_count, 1, __ATOMIC_RELAXED);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size) {
+    __atomic_fetch_add(&allocation_count, 1, __ATOMIC_RELAXED);
+    return __libc_realloc(pointer, size);
+}
+#endif
+
+#define BENCH_TILE_SIZE 16
+#define BENCH_STEP_RATE 60
+#define BENCH_PROJECTILE_SPEED 2000
+
+typedef struct bench_config {
+    const char *scenario;
+    u32 statics;
+    u32 bodies;
+    u32 steps;
+    u32 warmup;
+    u32 workers;
+    u32 seed;
+    bool is_json;
+    bool is_rollback_check;
+    bool is_contacts_check;
+} Bench_Config;
+
+typedef struct bench_result {
+    const char *scenario;
+    u32 statics;
+    u32 colliders;
+    u32 bodies;
+    u32 workers;
+    u32 steps;
+    f64 ns_per_body_step;
+    f64 p50_us;
+    f64 p99_us;
+    f64 candidate_pairs;
+    f64 hits;
+    f64 substeps;
+    f64 callbacks;
+    // Mean time to save a rollback snapshot after a step.
+    f64 snapshot_us;
+    i64 allocations;
+    u32 awake_bodies;
+    u32 sleeping_bodies;
+    u32 held_bodies;
+} Bench_Result;
+
+typedef void (*Bench_Setup)(Bench_Config *config);
+// Drives the scenario before the given step, counted from the first warmup
+// step. Optional.
+typedef void (*Bench_Step)(u32 step);
+
+typedef struct bench_scenario {
+    const char *name;
+    Bench_Setup setup;
+    Bench_Step step;
+} Bench_Scenario;
+
+static u32 random_state;
+
+static u32 random_next(void) {
+    random_state = random_state * 1664525u + 1013904223u;
+    return random_state >> 8;
+}
+
+static f32 random_range(f32 min, f32 max) {
+    return min + (max - min) * (f32)(random_next() & 0xFFFF) / 65535.f;
+}
+
+static u64 time_now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (u64)now.tv_sec * 1000000000ull + (u64)now.tv_nsec;
+}
+
+static u32 level_width(Bench_Config *config) {
+    u32 columns = 1;
+    while (columns * columns < config->statics) {
+        ++columns;
+    }
+    // Wide and shallow like a platformer level.
+    return columns * 4;
+}
+
+// Floor row across the whole level, then the rest of the budget as pillars
+// and floating platforms. Terrain sits on the terrain layer like the editor's.
+static void terrain_create(Bench_Config *config) {
+    u32 width = level_width(config);
+    u32 count = 0;
+
+    for (u32 x = 0; x < width && count < config->statics; ++x, ++count) {
+        physics_static_body_create(
+            (vec2){x * BENCH_TILE_SIZE + BENCH_TILE_SIZE * 0.5f, BENCH_TILE_SIZE * 0.5f},
+            (vec2){BENCH_TILE_SIZE, BENCH_TILE_SIZE},
+            COLLISION_LAYER_TERRAIN
+        );
+    }
+
+    while (count < config->statics) {
+        u32 column = random_next() % width;
+        u32 row = 2 + random_next() % 24;
+
+        physics_static_body_create(
+            (vec2){column * BENCH_TILE_SIZE + BENCH_TILE_SIZE * 0.5f, row * BENCH_TILE_SIZE + BENCH_TILE_SIZE * 0.5f},
+            (vec2){BENCH_TILE_SIZE, BENCH_TILE_SIZE},
+            COLLISION_LAYER_TERRAIN
+        );
+        ++count;
+    }
+
+    physics_static_body_commit();
+}
+
+// Every contact callback the physics step makes.
+static u64 callback_count;
+
+static void counting_on_hit(Body *self, Body *other, Hit hit) {
+    (void)self;
+    (void)other;
+    (void)hit;
+    ++callback_count;
+}
+
+static void projectile_on_hit_static(Body *self, Static_Body *other, Hit hit) {
+    (void)other;
+    ++callback_count;
+    if (hit.normal[0] != 0) {
+        self->velocity[0] = hit.normal[0] * BENCH_PROJECTILE_SPEED;
+    }
+}
+
+static void counting_on_trigger(Trigger *self, Body *other, Hit hit) {
+    (void)self;
+    (void)other;
+    (void)hit;
+    ++callback_count;
+}
+
+static void walker_on_hit_static(Body *self, Static_Body *other, Hit hit) {
+    (void)other;
+    ++callback_count;
+    if (hit.normal[0] != 0) {
+        self->velocity[0] = hit.normal[0] * 200;
+    }
+}
+
+// Begin and end events the resting bodies heard from the floor.
+static u32 resting_begins;
+static u32 resting_ends;
+static usize *resting_ids;
+static u32 resting_count;
+
+static void resting_on_hit_static(Body *self, Static_Body *other, Hit hit) {
+    (void)self;
+    (void)other;
+    ++callback_count;
+    resting_begins += hit.event == CONTACT_EVENT_BEGIN;
+    resting_ends += hit.event == CONTACT_EVENT_END;
+}
+
+// Bodies walking back and forth across the terrain, bouncing off pillars.
+static void scenario_tiles(Bench_Config *config) {
+    terrain_create(config);
+
+    f32 width = level_width(config) * BENCH_TILE_SIZE;
+
+    for (u32 i = 0; i < config->bodies; ++i) {
+        physics_body_create(
+            (vec2){random_range(32, width - 32), random_range(32, 480)},
+            (vec2){12, 12}, (vec2){random_range(-200, 200), 0}, 1,
+            COLLISION_LAYER_ENEMY, COLLISION_LAYER_TERRAIN, false, NULL, walker_on_hit_static
+        );
+    }
+}
+
+// Bodies dropped from above that land and settle on the terrain.
+static void scenario_falling(Bench_Config *config) {
+    terrain_create(config);
+
+    f32 width = level_width(config) * BENCH_TILE_SIZE;
+
+    for (u32 i = 0; i < config->bodies; ++i) {
+        physics_body_create(
+            (vec2){random_range(32, width - 32), random_range(500, 2000)},
+            (vec2){12, 12}, (vec2){0, 0}, 1,
+            COLLISION_LAYER_ENEMY, COLLISION_LAYER_TERRAIN | COLLISION_LAYER_PLAYER, false, NULL, NULL
+        );
+    }
+}
+
+// Fast kinematic projectiles bouncing between walls through a crowd of
+// walking enemies.
+static void scenario_storm(Bench_Config *config) {
+    terrain_create(config);
+
+    f32 width = level_width(config) * BENCH_TILE_SIZE;
+    u32 enemies = config->bodies / 4;
+
+    for (u32 i = 0; i < enemies; ++i) {
+        physics_body_create(
+            (vec2){random_range(32, width - 32), 40},
+            (vec2){16, 16}, (vec2){random_range(-200, 200), 0}, 1,
+            COLLISION_LAYER_ENEMY, COLLISION_LAYER_TERRAIN | COLLISION_LAYER_PLAYER, false, NULL, walker_on_hit_static
+        );
+    }
+
+    for (u32 i = enemies; i < config->bodies; ++i) {
+        f32 direction = (random_next() & 1) ? 1 : -1;
+
+        physics_body_create(
+            (vec2){random_range(32, width - 32), random_range(24, 420)},
+            (vec2){6, 6}, (vec2){direction * BENCH_PROJECTILE_SPEED, 0}, 1,
+            COLLISION_LAYER_PLAYER, COLLISION_LAYER_TERRAIN | COLLISION_LAYER_ENEMY, true, counting_on_hit, projectile_on_hit_static
+        );
+    }
+}
+
+// Every body dropped into one narrow pit, so they overlap and the body grid
+// cells get crowded. Bodies only listen for contacts starting and ending.
+static void scenario_pile(Bench_Config *config) {
+    terrain_create(config);
+
+    f32 pit_width = 16 * BENCH_TILE_SIZE;
+
+    physics_static_body_create((vec2){0, 512}, (vec2){BENCH_TILE_SIZE, 1024}, COLLISION_LAYER_TERRAIN);
+    physics_static_body_create((vec2){pit_width, 512}, (vec2){BENCH_TILE_SIZE, 1024}, COLLISION_LAYER_TERRAIN);
+    physics_static_body_commit();
+
+    for (u32 i = 0; i < config->bodies; ++i) {
+        usize id = physics_body_create(
+            (vec2){random_range(24, pit_width - 24), random_range(32, 1000)},
+            (vec2){12, 12}, (vec2){random_range(-50, 50), 0}, 1,
+            COLLISION_LAYER_ENEMY, COLLISION_LAYER_TERRAIN | COLLISION_LAYER_ENEMY, false, counting_on_hit, NULL
+        );
+        physics_body_set_contact_events(id, CONTACT_EVENT_BEGIN | CONTACT_EVENT_END);
+    }
+}
+
+// The tiles walkers passing through pickups scattered over the level, one
+// per eight bodies. Pickups only hear about walkers entering them.
+static void scenario_triggers(Bench_Config *config) {
+    scenario_tiles(config);
+
+    f32 width = level_width(config) * BENCH_TILE_SIZE;
+
+    for (u32 i = 0; i < config->bodies / 8; ++i) {
+        usize id = physics_trigger_create(
+            (vec2){random_range(32, width - 32), random_range(32, 480)},
+            (vec2){24, 24}, COLLISION_LAYER_ENEMY, counting_on_trigger
+        );
+        physics_trigger_get(id)->contact_events = CONTACT_EVENT_BEGIN;
+    }
+}
+
+// The tiles walkers seen from a player near the left of the level. Walkers
+// past 512 units step every fourth step, and past 2048 they are frozen.
+static void scenario_lod(Bench_Config *config) {
+    scenario_tiles(config);
+
+    f32 width = level_width(config) * BENCH_TILE_SIZE;
+    vec2 focus = {width * 0.1f, 64};
+
+    physics_lod_set(512, 2048, 4);
+    physics_lod_set_focus(&focus, 1);
+}
+
+// Walkers packed into a quarter of the level, split over every layer but
+// terrain. Each only collides with terrain and its own layer, like separate
+// teams, projectiles and pickups sharing a crowded area.
+static void scenario_layers(Bench_Config *config) {
+    terrain_create(config);
+
+    f32 width = level_width(config) * BENCH_TILE_SIZE * 0.25f;
+
+    for (u32 i = 0; i < config->bodies; ++i) {
+        u8 layer = 1 << (i % 7);
+
+        if (layer >= COLLISION_LAYER_TERRAIN) {
+            layer <<= 1;
+        }
+
+        physics_body_create(
+            (vec2){random_range(32, width - 32), random_range(32, 480)},
+            (vec2){12, 12}, (vec2){random_range(-200, 200), 0}, 1,
+            layer, COLLISION_LAYER_TERRAIN | layer, false, NULL, walker_on_hit_static
+        );
+    }
+}
+
+// Bodies dropped a short way onto a bare floor, where they settle and fall
+// asleep. They only collide with the floor, so each touches one collider.
+static void scenario_resting(Bench_Config *config) {
+    u32 width = level_width(config);
+
+    for (u32 x = 0; x < width; ++x) {
+        physics_static_body_create(
+            (vec2){x * BENCH_TILE_SIZE + BENCH_TILE_SIZE * 0.5f, BENCH_TILE_SIZE * 0.5f},
+            (vec2){BENCH_TILE_SIZE, BENCH_TILE_SIZE},
+            COLLISION_LAYER_TERRAIN
+        );
+    }
+    physics_static_body_commit();
+
+    resting_begins = 0;
+    resting_ends = 0;
+    resting_count = config->bodies;
+    resting_ids = realloc(resting_ids, (config->bodies ? config->bodies : 1) * sizeof(usize));
+
+    if (!resting_ids) {
+        ERROR_EXIT("Could not allocate memory for resting bodies\n");
+    }
+
+    for (u32 i = 0; i < config->bodies; ++i) {
+        resting_ids[i] = physics_body_create(
+            (vec2){random_range(32, width * BENCH_TILE_SIZE - 32.f), random_range(32, 200)},
+            (vec2){12, 12}, (vec2){0, 0}, 1,
+            COLLISION_LAYER_ENEMY, COLLISION_LAYER_TERRAIN, false, NULL, resting_on_hit_static
+        );
+    }
+}
+
+// Every 64 steps a quarter of the resting bodies jump off the floor, in
+// turn, so asleep ones wake and end their contact.
+static void resting_step(u32 step) {
+    if (step == 0 || step % 64 != 0) {
+        return;
+    }
+
+    for (u32 i = (step / 64) % 4; i < resting_count; i += 4) {
+        physics_body_get(resting_ids[i])->velocity[1] = 600;
+    }
+}
+
+static const Bench_Scenario scenarios[] = {
+    {"tiles", scenario_tiles, NULL},
+    {"falling", scenario_falling, NULL},
+    {"storm", scenario_storm, NULL},
+    {"pile", scenario_pile, NULL},
+    {"triggers", scenario_triggers, NULL},
+    {"lod", scenario_lod, NULL},
+    {"layers", scenario_layers, NULL},
+    {"resting", scenario_resting, resting_step},
+};
+
+static int compare_u64(const void *a, const void *b) {
+    u64 x = *(const u64 *)a;
+    u64 y = *(const u64 *)b;
+    return (x > y) - (x < y);
+}
+
+static Bench_Result scenario_run(Bench_Config *config, const Bench_Scenario *scenario) {
+    f32 dt = 1.f / BENCH_STEP_RATE;
+
+    random_state = config->seed;
+
+    physics_init();
+    physics_set_worker_count(config->workers);
+    scenario->setup(config);
+
+    // Saving during warmup fills the snapshot ring, so the measured steps
+    // show the steady state.
+    for (u32 i = 0; i < config->warmup; ++i) {
+        if (scenario->step) {
+            scenario->step(i);
+        }
+        physics_update(dt);
+        physics_snapshot_save();
+    }
+
+    u64 *times = malloc(config->steps * sizeof(u64));
+
+    if (!times) {
+        ERROR_EXIT("Could not allocate memory for step times\n");
+    }
+
+    u64 candidate_pairs = 0;
+    u64 hits = 0;
+    u64 substeps = 0;
+    u64 total = 0;
+    u64 snapshot_total = 0;
+
+    callback_count = 0;
+#if defined(BENCH_COUNT_ALLOCATIONS)
+    u64 allocations = __atomic_load_n(&allocation_count, __ATOMIC_RELAXED);
+#endif
+
+    for (u32 i = 0; i < config->steps; ++i) {
+        if (scenario->step) {
+            scenario->step(config->warmup + i);
+        }
+
+        u64 start = time_now_ns();
+        physics_update(dt);
+        times[i] = time_now_ns() - start;
+        total += times[i];
+
+        start = time_now_ns();
+        physics_snapshot_save();
+        snapshot_total += time_now_ns() - start;
+
+        Physics_Stats stats = physics_stats_get();
+        candidate_pairs += stats.candidate_pairs;
+        hits += stats.hits;
+        substeps += stats.substeps;
+    }
+
+    Physics_Stats stats = physics_stats_get();
+    qsort(times, config->steps, sizeof(u64), compare_u64);
+
+    Bench_Result result = {
+        .scenario = scenario->name,
+        .statics = (u32)physics_static_body_count(),
+        .colliders = (u32)physics_static_collider_count(),
+        .bodies = config->bodies,
+        .workers = config->workers,
+        .steps = config->steps,
+        .ns_per_body_step = config->bodies > 0 ? (f64)total / config->steps / config->bodies : 0,
+        .p50_us = times[config->steps / 2] / 1000.0,
+        .p99_us = times[(config->steps * 99) / 100] / 1000.0,
+        .candidate_pairs = (f64)candidate_pairs / config->steps,
+        .hits = (f64)hits / config->steps,
+        .substeps = (f64)substeps / config->steps,
+        .callbacks = (f64)callback_count / config->steps,
+        .snapshot_us = snapshot_total / 1000.0 / config->steps,
+        .allocations = -1,
+        .awake_bodies = stats.awake_bodies,
+        .sleeping_bodies = stats.sleeping_bodies,
+        .held_bodies = stats.held_bodies,
+    };
+
+#if defined(BENCH_COUNT_ALLOCATIONS)
+    result.allocations = (i64)(__atomic_load_n(&allocation_count, __ATOMIC_RELAXED) - allocations);
+#endif
+
+    free(times);
+
+    // Stops the worker threads before the next scenario re-initialises.
+    physics_set_worker_count(0);
+
+    return result;
+}
+
+// Saves a frame after warmup, steps from it, restores it and steps again,
+// comparing the checksum and the callbacks made so far after every step.
+// Returns whether the runs match.
+static bool rollback_check(Bench_Config *config, const Bench_Scenario *scenario) {
+    f32 dt = 1.f / BENCH_STEP_RATE;
+
+    random_state = config->seed;
+
+    physics_init();
+    physics_set_worker_count(config->workers);
+    scenario->setup(config);
+
+    for (u32 i = 0; i < config->warmup; ++i) {
+        if (scenario->step) {
+            scenario->step(i);
+        }
+        physics_update(dt);
+    }
+
+    u64 *checksums = malloc(config->steps * sizeof(u64));
+    u64 *callbacks = malloc(config->steps * sizeof(u64));
+
+    if (!checksums || !callbacks) {
+        ERROR_EXIT("Could not allocate memory for checksums\n");
+    }
+
+    u32 frame = physics_snapshot_save();
+    callback_count = 0;
+
+    for (u32 i = 0; i < config->steps; ++i) {
+        if (scenario->step) {
+            scenario->step(config->warmup + i);
+        }
+        physics_update(dt);
+        checksums[i] = physics_checksum();
+        callbacks[i] = callback_count;
+    }
+
+    if (physics_snapshot_restore(frame) != 0) {
+        ERROR_EXIT("Could not restore frame %u\n", frame);
+    }
+
+    bool is_match = true;
+    callback_count = 0;
+
+    for (u32 i = 0; i < config->steps; ++i) {
+        if (scenario->step) {
+            scenario->step(config->warmup + i);
+        }
+        physics_update(dt);
+
+        if (physics_checksum() != checksums[i] || callback_count != callbacks[i]) {
+            printf("%s: rollback diverged at step %u of %u\n", scenario->name, i + 1, config->steps);
+            is_match = false;
+            break;
+        }
+    }
+
+    if (is_match) {
+        printf("%s: rollback matched over %u steps\n", scenario->name, config->steps);
+    }
+
+    free(checksums);
+    free(callbacks);
+    physics_set_worker_count(0);
+
+    return is_match;
+}
+
+// Runs the resting scenario until every body sleeps, wakes them in place,
+// then makes them jump off the floor. Returns whether each body saw one
+// begin, kept its contact while asleep and saw one end when it left.
+static bool contacts_check(Bench_Config *config) {
+    f32 dt = 1.f / BENCH_STEP_RATE;
+
+    random_state = config->seed;
+
+    physics_init();
+    physics_set_worker_count(config->workers);
+    scenario_resting(config);
+
+    for (u32 i = 0; i < config->steps; ++i) {
+        physics_update(dt);
+    }
+
+    bool is_match = true;
+    Physics_Stats stats = physics_stats_get();
+
+    if (stats.sleeping_bodies != config->bodies) {
+        printf("resting: %u of %u bodies asleep after %u steps\n", stats.sleeping_bodies, config->bodies, config->steps);
+        is_match = false;
+    }
+
+    if (resting_begins != config->bodies || resting_ends != 0) {
+        printf("resting: %u begins and %u ends while resting, expected %u and 0\n", resting_begins, resting_ends, config->bodies);
+        is_match = false;
+    }
+
+    for (u32 i = 0; i < config->bodies; ++i) {
+        physics_body_wake(resting_ids[i]);
+    }
+    physics_update(dt);
+
+    if (resting_begins != config->bodies || resting_ends != 0) {
+        printf("resting: %u begins and %u ends after waking, expected %u and 0\n", resting_begins, resting_ends, config->bodies);
+        is_match = false;
+    }
+
+    for (u32 i = 0; i < config->bodies; ++i) {
+        physics_body_get(resting_ids[i])->velocity[1] = 600;
+    }
+    physics_update(dt);
+
+    if (resting_ends != config->bodies) {
+        printf("resting: %u ends after jumping, expected %u\n", resting_ends, config->bodies);
+        is_match = false;
+    }
+
+    if (is_match) {
+        printf("resting: contacts matched for %u bodies\n", config->bodies);
+    }
+
+    physics_set_worker_count(0);
+
+    return is_match;
+}
+
+static void result_print(Bench_Result *result, bool is_json, bool is_first) {
+    if (is_json) {
+        printf(
+            "%s  {\"scenario\": \"%s\", \"statics\": %u, \"colliders\": %u, \"bodies\": %u, \"workers\": %u, \"steps\": %u, "
+            "\"ns_per_body_step\": %.2f, \"p50_us\": %.2f, \"p99_us\": %.2f, "
+            "\"candidate_pairs\": %.1f, \"hits\": %.1f, \"substeps\": %.1f, \"callbacks\": %.1f, \"snapshot_us\": %.2f, \"allocations\": %lld, "
+            "\"awake_bodies\": %u, \"sleeping_bodies\": %u, \"held_bodies\": %u}",
+            is_first ? "" : ",\n",
+            result->scenario, result->statics, result->colliders, result->bodies, result->workers, result->steps,
+            result->ns_per_body_step, result->p50_us, result->p99_us,
+            result->candidate_pairs, result->hits, result->substeps, result->callbacks, result->snapshot_us, (long long)result->allocations,
+            result->awake_bodies, result->sleeping_bodies, result->held_bodies
+        );
+        return;
+    }
+
+    if (is_first) {
+        printf("scenario,statics,colliders,bodies,workers,steps,ns_per_body_step,p50_us,p99_us,candidate_pairs,hits,substeps,callbacks,snapshot_us,allocations,awake_bodies,sleeping_bodies,held_bodies\n");
+    }
+
+    printf(
+        "%s,%u,%u,%u,%u,%u,%.2f,%.2f,%.2f,%.1f,%.1f,%.1f,%.1f,%.2f,%lld,%u,%u,%u\n",
+        result->scenario, result->statics, result->colliders, result->bodies, result->workers, result->steps,
+        result->ns_per_body_step, result->p50_us, result->p99_us,
+        result->candidate_pairs, result->hits, result->substeps, result->callbacks, result->snapshot_us, (long long)result->allocations,
+        result->awake_bodies, result->sleeping_bodies, result->held_bodies
+    );
+}
+
+static u32 argument_u32(int argc, char **argv, int *i) {
+    if (*i + 1 >= argc) {
+        ERROR_EXIT("Missing value for %s\n", argv[*i]);
+    }
+    return (u32)strtoul(argv[++*i], NULL, 10);
+}
+
+int main(int argc, char **argv) {
+    Bench_Config config = {
+        .scenario = "all",
+        .statics = 4096,
+        .bodies = 1000,
+        .steps = 600,
+        .warmup = 60,
+        .workers = 0,
+        .seed = 1,
+        .is_json = false,
+    };
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--scenario") == 0 && i + 1 < argc) {
+            config.scenario = argv[++i];
+        } else if (strcmp(argv[i], "--statics") == 0) {
+            config.statics = argument_u32(argc, argv, &i);
+        } else if (strcmp(argv[i], "--bodies") == 0) {
+            config.bodies = argument_u32(argc, argv, &i);
+        } else if (strcmp(argv[i], "--steps") == 0) {
+            config.steps = argument_u32(argc, argv, &i);
+        } else if (strcmp(argv[i], "--warmup") == 0) {
+            config.warmup = argument_u32(argc, argv, &i);
+        } else if (strcmp(argv[i], "--workers") == 0) {
+            config.workers = argument_u32(argc, argv, &i);
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            config.seed = argument_u32(argc, argv, &i);
+        } else if (strcmp(argv[i], "--check-rollback") == 0) {
+            config.is_rollback_check = true;
+        } else if (strcmp(argv[i], "--check-contacts") == 0) {
+            config.is_contacts_check = true;
+        } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            config.is_json = strcmp(argv[++i], "json") == 0;
+        } else {
+            ERROR_EXIT("Unknown argument %s\n", argv[i]);
+        }
+    }
+
+    if (config.steps == 0) {
+        ERROR_EXIT("--steps must be at least 1\n");
+    }
+
+    bool is_known = strcmp(config.scenario, "all") == 0;
+
+    for (usize i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); ++i) {
+        is_known |= strcmp(config.scenario, scenarios[i].name) == 0;
+    }
+
+    if (!is_known) {
+        ERROR_EXIT("Unknown scenario %s\n", config.scenario);
+    }
+
+    if (config.is_contacts_check) {
+        return contacts_check(&config) ? 0 : 1;
+    }
+
+    if (config.is_rollback_check) {
+        bool is_match = true;
+
+        for (usize i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); ++i) {
+            if (strcmp(config.scenario, "all") != 0 && strcmp(config.scenario, scenarios[i].name) != 0) {
+                continue;
+            }
+
+            is_match &= rollback_check(&config, &scenarios[i]);
+        }
+
+        return is_match ? 0 : 1;
+    }
+
+    bool is_first = true;
+
+    if (config.is_json) {
+        printf("[\n");
+    }
+
+    for (usize i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); ++i) {
+        if (strcmp(config.scenario, "all") != 0 && strcmp(config.scenario, scenarios[i].name) != 0) {
+            continue;
+        }
+
+        Bench_Result result = scenario_run(&config, &scenarios[i]);
+        result_print(&result, config.is_json, is_first);
+        is_first = false;
+    }
+
+    if (config.is_json) {
+        printf("\n]\n");
+    }
+
+    return 0;
+}
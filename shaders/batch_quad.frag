@@ -3,10 +3,11 @@ out vec4 o_color;
 
 in vec4 v_color;
 in vec2 v_uvs;
+flat in uint v_layer;
 
-uniform sampler2D texture_slot;
+uniform sampler2DArray texture_slot;
 
 
 void main() {
-    o_color = texture(texture_slot, v_uvs) * v_color;
+    o_color = texture(texture_slot, vec3(v_uvs, v_layer)) * v_color;
 }
\ No newline at end of file
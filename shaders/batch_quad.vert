@@ -1,16 +1,23 @@
 #version 410 core
-layout (location = 0) in vec2 a_pos;
-layout (location = 1) in vec2 a_uvs;
-layout (location = 2) in vec4 a_color;
+layout (location = 0) in vec2 a_position;
+layout (location = 1) in vec2 a_size;
+layout (location = 2) in vec4 a_uvs;
+layout (location = 3) in vec4 a_color;
+layout (location = 4) in uint a_layer;
 
 out vec4 v_color;
 out vec2 v_uvs;
+flat out uint v_layer;
 
 uniform mat4 projection;
 
 
 void main() {
+    // Triangle strip corners (0, 0), (1, 0), (0, 1), (1, 1)
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+
     v_color = a_color;
-    v_uvs = a_uvs;
-    gl_Position = projection * vec4(a_pos, 0.0, 1.0);
+    v_uvs = mix(a_uvs.xy, a_uvs.zw, corner);
+    v_layer = a_layer;
+    gl_Position = projection * vec4(a_position + a_size * corner, 0.0, 1.0);
 }
\ No newline at end of file
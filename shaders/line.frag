@@ -0,0 +1,9 @@
+#version 410 core
+out vec4 frag_color;
+
+in vec4 v_color;
+
+
+void main() {
+    frag_color = v_color;
+}
\ No newline at end of file
@@ -0,0 +1,12 @@
+#version 410 core
+layout (location = 0) in vec2 a_position;
+layout (location = 1) in vec4 a_color;
+
+out vec4 v_color;
+
+uniform mat4 projection;
+
+void main() {
+    v_color = a_color;
+    gl_Position = projection * vec4(a_position, 0.0, 1.0);
+}
\ No newline at end of file
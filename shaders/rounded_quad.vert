@@ -1,13 +1,26 @@
 #version 410 core
 layout (location = 0) in vec2 a_position;
+layout (location = 1) in vec2 a_size;
+layout (location = 2) in vec4 a_color;
+layout (location = 3) in float a_border_radius;
 
-out vec2 v_world_position;
+out vec2 v_local_position;
+flat out vec2 v_half_size;
+flat out vec4 v_color;
+flat out float v_border_radius;
 
 uniform mat4 projection;
-uniform mat4 model;
+
+// Room around the rectangle for the anti-aliased edge to fade out in.
+const float margin = 1.0;
 
 void main() {
-    vec4 world_position = model * vec4(a_position, 0.0, 1.0);
-    v_world_position = world_position.xy;
-    gl_Position = projection * world_position;
-}
\ No newline at end of file
+    // Triangle strip corners (-1, -1), (1, -1), (-1, 1), (1, 1)
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+
+    v_half_size = a_size * 0.5;
+    v_local_position = corner * (v_half_size + margin);
+    v_color = a_color;
+    v_border_radius = min(a_border_radius, min(v_half_size.x, v_half_size.y));
+    gl_Position = projection * vec4(a_position + v_local_position, 0.0, 1.0);
+}
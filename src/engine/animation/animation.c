@@ -1,14 +1,15 @@
 #include <assert.h>
 
 #include "../util/util.h"
+#include "../util/slot_map.h"
 #include "animation.h"
 
 static Array_List *animation_definition_storage;
-static Array_List *animation_storage;
+static Slot_Map *animation_storage;
 
 void animation_init(void) {
     animation_definition_storage = array_list_create(sizeof(Animation_Definition), 0);
-    animation_storage = array_list_create(sizeof(Animation), 0);
+    animation_storage = slot_map_create(sizeof(Animation), 0);
 };
 
 usize animation_definition_create(Sprite_Sheet *sprite_sheet, f32 *durations, u8 *rows, u8 *columns, u8 frame_count) {
@@ -31,52 +32,48 @@ usize animation_definition_create(Sprite_Sheet *sprite_sheet, f32 *durations, u8
 };
 
 usize animation_create(usize animation_definition_id, bool does_loop) {
-    usize id = animation_storage->len;
     Animation_Definition *adef = array_list_get(animation_definition_storage, animation_definition_id);
 
     if (adef == NULL) {
         ERROR_EXIT("Animation Definition with id %zu not found.", animation_definition_id);
     };
 
-    // Try ti find free slot first.
-
-    for (usize i = 0; i < animation_storage->len; ++i) {
-        Animation *animation  = array_list_get(animation_storage, i);
-        if (!animation->is_active) {
-            id = i;
-            break;
-        };
-    };
-
-    if (id == animation_storage->len) {
-        array_list_append(animation_storage, &(Animation){0});
-    };
-
-    Animation *animation = array_list_get(animation_storage, id);
-
     // Other fields default to 0 when using field dot syntax.
 
-    *animation = (Animation){
+    Animation animation = {
         .definition = adef,
         .does_loop = does_loop,
         .is_active = true,
     };
 
+    usize id = slot_map_insert(animation_storage, &animation);
+
+    if (id == SLOT_MAP_INVALID) {
+        ERROR_EXIT("Could not append animation to list\n");
+    };
+
     return id;
 };
 
 void animation_destroy(usize id) {
-    Animation *animation = array_list_get(animation_storage, id);
-    animation->is_active = false;
+    if (slot_map_remove(animation_storage, id) != 0) {
+        fprintf(stderr, "Animation %zu not found\n", id);
+    };
 };
 
+// Returns NULL once the animation has been destroyed.
 Animation *animation_get(usize id) {
-    return array_list_get(animation_storage, id);
+    return slot_map_get(animation_storage, id);
 };
 
 void animation_update(f32 dt) {
-    for (usize i = 0; i < animation_storage->len; i++) {
-        Animation *animation = array_list_get(animation_storage, i);
+    for (usize i = 0; i < slot_map_len(animation_storage); i++) {
+        Animation *animation = slot_map_at(animation_storage, i);
+
+        if (animation == NULL) {
+            continue;
+        };
+
         Animation_Definition *adef = animation->definition;
         animation->current_frame_time -= dt;
 
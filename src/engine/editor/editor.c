@@ -10,7 +10,27 @@
 #include <stdbool.h>
 
 
+#define EDITOR_PICK_CAPACITY 64
+#define EDITOR_SOURCE_CAPACITY 256
+#define EDITOR_HANDLE_SIZE 5
+
 static Editor_State editor_state;
+static Physics_Query_Hit pick_results[EDITOR_PICK_CAPACITY];
+static u32 pick_sources[EDITOR_SOURCE_CAPACITY];
+
+// Static sprites a tiled body's tiles were built into, from `first` on.
+typedef struct tile_range {
+    u32 first;
+    u32 count;
+    bool is_dirty;
+} Tile_Range;
+
+// Tiles of every tiled body, kept in the renderer's static sprites in body
+// order. A dirty body keeping its tile count is rewritten where it is; one
+// whose count changed, like a body added or removed, rebuilds itself and
+// every body after it from tiles_rebuild_from on.
+static Array_List *list_tile_ranges;
+static usize tiles_rebuild_from;
 
 void editor_init(void) {
     editor_state.list_tiled_static_bodies = array_list_create(sizeof(Tiled_Static_Body), 8);
@@ -20,6 +40,74 @@ void editor_init(void) {
     editor_state.active_body = (usize)-1;
     editor_state.action = IDLE;
 
+    list_tile_ranges = array_list_create(sizeof(Tile_Range), 8);
+    tiles_rebuild_from = 0;
+}
+
+static void tiles_mark_dirty(usize index) {
+    if (index < list_tile_ranges->len) {
+        ((Tile_Range *)array_list_get(list_tile_ranges, index))->is_dirty = true;
+    }
+}
+
+static void tiles_rebuild_from_body(usize index) {
+    if (index < tiles_rebuild_from) {
+        tiles_rebuild_from = index;
+    }
+}
+
+static void handle_aabb_get(AABB *out, Static_Body *static_body) {
+    *out = (AABB){
+        .position = {
+            static_body->aabb.position[0] + static_body->aabb.half_size[0] - EDITOR_HANDLE_SIZE * 0.5f,
+            static_body->aabb.position[1] - static_body->aabb.half_size[1] + EDITOR_HANDLE_SIZE * 0.5f,
+        },
+        .half_size = {EDITOR_HANDLE_SIZE * 0.5f, EDITOR_HANDLE_SIZE * 0.5f},
+    };
+}
+
+// Lowest index static body containing the point, or whose resize handle
+// does. Queries return merged colliders, so each is narrowed back to the
+// bodies it was built from. A handle sits inside its body's bottom-right
+// corner, so only colliders within one handle size of the point can own it.
+// Only terrain is queried, which is all the editor places, so bodies under
+// the cursor cannot crowd the colliders out of the results. A collider's
+// sources are read EDITOR_SOURCE_CAPACITY at a time.
+static usize static_body_pick(vec2 point, bool is_handle) {
+    AABB pick_aabb = {
+        .position = {point[0], point[1]},
+        .half_size = {is_handle ? EDITOR_HANDLE_SIZE : 0, is_handle ? EDITOR_HANDLE_SIZE : 0},
+    };
+    usize picked = (usize)-1;
+    usize pick_count = physics_overlap_aabb(pick_aabb, COLLISION_LAYER_TERRAIN, pick_results, EDITOR_PICK_CAPACITY);
+
+    for (usize i = 0; i < pick_count; ++i) {
+        if (!pick_results[i].is_static) {
+            continue;
+        }
+
+        usize offset = 0;
+        usize source_count;
+
+        while ((source_count = physics_static_collider_sources(pick_results[i].id, offset, pick_sources, EDITOR_SOURCE_CAPACITY)) > 0) {
+            for (usize j = 0; j < source_count; ++j) {
+                Static_Body *static_body = physics_static_body_get(pick_sources[j]);
+                AABB aabb = static_body->aabb;
+
+                if (is_handle) {
+                    handle_aabb_get(&aabb, static_body);
+                }
+
+                if (pick_sources[j] < picked && physics_point_intersect_aabb(point, aabb)) {
+                    picked = pick_sources[j];
+                }
+            }
+
+            offset += source_count;
+        }
+    }
+
+    return picked;
 }
 
 void select_sprite(AABB *aabb, void *user_data) {
@@ -140,24 +228,29 @@ void load_level() {
     memcpy(list->items, (char *)file.data + sizeof(Array_List), list->capacity * list->item_size);
 
     editor_state.list_tiled_static_bodies = list;
+    tiles_rebuild_from_body(0);
 
     // Free the file data if necessary
     // free(file.data);
 }
 
-void render_tiled_static_body(Static_Body *static_body, Sprite_Sheet *sprite_sheet, int row, int col) {
+static void tiled_static_body_grid(Static_Body *static_body, Sprite_Sheet *sprite_sheet, int *tiles_x, int *tiles_y) {
     // Calculate the size of the static body
     vec2 size;
     vec2_scale(size, static_body->aabb.half_size, 2.0f);
 
+    // Compute the number of tiles needed along the X and Y axes
+    *tiles_x = (int)ceil(size[0] / sprite_sheet->cell_width);
+    *tiles_y = (int)ceil(size[1] / sprite_sheet->cell_height);
+}
+
+// Writes the body's tiles into static sprites from `first` on. The grid
+// must be the one tiled_static_body_grid gives now.
+void render_tiled_static_body(u32 first, Static_Body *static_body, Sprite_Sheet *sprite_sheet, int row, int col, int tiles_x, int tiles_y) {
     // Calculate the minimum (left, bottom) positions of the AABB
     float min_x = static_body->aabb.position[0] - static_body->aabb.half_size[0];
     float min_y = static_body->aabb.position[1] - static_body->aabb.half_size[1];
 
-    // Compute the number of tiles needed along the X and Y axes
-    int tiles_x = (int)ceil(size[0] / sprite_sheet->cell_width);
-    int tiles_y = (int)ceil(size[1] / sprite_sheet->cell_height);
-
     // Loop over the Y axis (rows)
     for (int y = 0; y < tiles_y; y++) {
         // Loop over the X axis (columns)
@@ -168,11 +261,85 @@ void render_tiled_static_body(Static_Body *static_body, Sprite_Sheet *sprite_she
 
             vec2 position = { tile_x, tile_y };
 
-            render_sprite_sheet_frame(sprite_sheet, row, col, position, false, true);
-            vec2 tile_size = { sprite_sheet->cell_width, sprite_sheet->cell_height };
-            render_quad(position, tile_size, WHITE);
+            render_static_sprite_sheet_frame(first++, sprite_sheet, row, col, position);
+        }
+    }
+}
+
+// Brings the static sprites up to date with the tiled bodies. Only dirty
+// bodies and those from tiles_rebuild_from on are touched, so an idle
+// frame costs one pass over the ranges.
+static void tiles_update(Sprite_Sheet *sprite_sheet) {
+    Array_List *bodies = editor_state.list_tiled_static_bodies;
+    usize body_count = bodies->len;
+
+    // Bodies whose tile count changed shift everything after them
+    for (usize i = 0; i < tiles_rebuild_from && i < list_tile_ranges->len; ++i) {
+        Tile_Range *range = array_list_get(list_tile_ranges, i);
+        if (!range->is_dirty) {
+            continue;
         }
+
+        int tiles_x, tiles_y;
+        tiled_static_body_grid(physics_static_body_get(i), sprite_sheet, &tiles_x, &tiles_y);
+        if ((u32)(tiles_x * tiles_y) != range->count) {
+            tiles_rebuild_from = i;
+            break;
+        }
+    }
+
+    if (tiles_rebuild_from > body_count) {
+        tiles_rebuild_from = body_count;
+    }
+    bool is_rebuilding = tiles_rebuild_from < body_count || tiles_rebuild_from < list_tile_ranges->len;
+    list_tile_ranges->len = tiles_rebuild_from < list_tile_ranges->len ? tiles_rebuild_from : list_tile_ranges->len;
+
+    for (usize i = 0; i < list_tile_ranges->len; ++i) {
+        Tile_Range *range = array_list_get(list_tile_ranges, i);
+        if (range->is_dirty) {
+            Tiled_Static_Body *tiled_static_body = array_list_get(bodies, i);
+            int tiles_x, tiles_y;
+            tiled_static_body_grid(physics_static_body_get(i), sprite_sheet, &tiles_x, &tiles_y);
+            render_tiled_static_body(range->first, physics_static_body_get(i), sprite_sheet, tiled_static_body->tile_coordinates.row, tiled_static_body->tile_coordinates.column, tiles_x, tiles_y);
+            range->is_dirty = false;
+        }
+    }
+
+    if (!is_rebuilding) {
+        return;
+    }
+
+    // Count first, so the static sprites are resized once
+    u32 first = 0;
+    if (list_tile_ranges->len > 0) {
+        Tile_Range *last = array_list_get(list_tile_ranges, list_tile_ranges->len - 1);
+        first = last->first + last->count;
+    }
+
+    u32 tile_count = first;
+    for (usize i = tiles_rebuild_from; i < body_count; ++i) {
+        int tiles_x, tiles_y;
+        tiled_static_body_grid(physics_static_body_get(i), sprite_sheet, &tiles_x, &tiles_y);
+        tile_count += tiles_x * tiles_y;
+    }
+    render_static_sprites_resize(tile_count);
+
+    for (usize i = tiles_rebuild_from; i < body_count; ++i) {
+        Static_Body *static_body = physics_static_body_get(i);
+        Tiled_Static_Body *tiled_static_body = array_list_get(bodies, i);
+
+        int tiles_x, tiles_y;
+        tiled_static_body_grid(static_body, sprite_sheet, &tiles_x, &tiles_y);
+        render_tiled_static_body(first, static_body, sprite_sheet, tiled_static_body->tile_coordinates.row, tiled_static_body->tile_coordinates.column, tiles_x, tiles_y);
+
+        array_list_append(list_tile_ranges, &(Tile_Range){
+            .first = first,
+            .count = tiles_x * tiles_y,
+        });
+        first += tiles_x * tiles_y;
     }
+
+    tiles_rebuild_from = body_count;
 }
 
 
@@ -235,6 +402,7 @@ void open_menu_on_toggle(AABB *aabb, void *user_data) {
 }
 
 void save_level_button(AABB *aabb, void *user_data) {
+    physics_static_body_commit();
     save_level_item(editor_state.list_tiled_static_bodies, "./tiled-static-bodies.bin");
     physics_static_body_dump("./static-bodies.bin");
 }
@@ -257,7 +425,9 @@ void remove_active_body(void) {
     usize removed_body_index = editor_state.active_body;
 
     physics_static_body_remove(editor_state.active_body);
+    physics_static_body_commit();
     editor_state.active_body = (usize)-1;
+    tiles_rebuild_from_body(removed_body_index);
 
     for (usize i = 0; i < editor_state.list_tiled_static_bodies->len;) {
         Tiled_Static_Body *body = array_list_get(editor_state.list_tiled_static_bodies, i);
@@ -281,35 +451,22 @@ void level_editor_render(void) {
 
     if (global.input.mouseRightClick) {
         if ((editor_state.action != CREATING) && (editor_state.action != RESIZING)) {
-            for (usize i = 0; i < physics_static_body_count(); ++i) {
-                Static_Body *static_body = physics_static_body_get(i);
-
-                vec2 size_handle = {5, 5};
-                vec2 handle_pos = {
-                    static_body->aabb.position[0] + static_body->aabb.half_size[0] - size_handle[0] * 0.5f,
-                    static_body->aabb.position[1] - static_body->aabb.half_size[1] + size_handle[1] * 0.5f
-                };
+            usize i = static_body_pick(mousePos_world, true);
 
-                AABB handle_aabb = {
-                    .position = {handle_pos[0], handle_pos[1]},
-                    .half_size = {size_handle[0] * 0.5f, size_handle[1] * 0.5f}
-                };
-
-                if (physics_point_intersect_aabb(mousePos_world, handle_aabb)) {
-                    editor_state.active_body = i;
-                    editor_state.action = RESIZING;
+            if (i != (usize)-1) {
+                Static_Body *static_body = physics_static_body_get(i);
 
-                    editor_state.startingX = mouseX_world;
-                    editor_state.startingY = mouseY_world;
+                editor_state.active_body = i;
+                editor_state.action = RESIZING;
 
-                    editor_state.initial_size[0] = static_body->aabb.half_size[0] * 2.0f;
-                    editor_state.initial_size[1] = static_body->aabb.half_size[1] * 2.0f;
+                editor_state.startingX = mouseX_world;
+                editor_state.startingY = mouseY_world;
 
-                    editor_state.initial_position[0] = static_body->aabb.position[0];
-                    editor_state.initial_position[1] = static_body->aabb.position[1];
+                editor_state.initial_size[0] = static_body->aabb.half_size[0] * 2.0f;
+                editor_state.initial_size[1] = static_body->aabb.half_size[1] * 2.0f;
 
-                    break;
-                }
+                editor_state.initial_position[0] = static_body->aabb.position[0];
+                editor_state.initial_position[1] = static_body->aabb.position[1];
             }
 
             // If not resizing, start creating a new body as before
@@ -320,6 +477,7 @@ void level_editor_render(void) {
                 vec2 size = {0, 0};
                 vec2 position = {editor_state.startingX, editor_state.startingY};
                 editor_state.active_body = physics_static_body_create(position, size, COLLISION_LAYER_TERRAIN);
+                tiles_rebuild_from_body(editor_state.list_tiled_static_bodies->len);
                 array_list_append(editor_state.list_tiled_static_bodies, &(Tiled_Static_Body){
                     .tile_coordinates = {
                         .column = editor_state.selected_sprite_coords[0],
@@ -343,11 +501,8 @@ void level_editor_render(void) {
 
         compute_resized_aabb(initial_position, initial_size, starting_mouse_pos, current_mouse_pos, &new_position, &new_half_size);
 
-        Static_Body *static_body = physics_static_body_get(editor_state.active_body);
-        static_body->aabb.position[0] = new_position[0];
-        static_body->aabb.position[1] = new_position[1];
-        static_body->aabb.half_size[0] = new_half_size[0];
-        static_body->aabb.half_size[1] = new_half_size[1];
+        physics_static_body_set_aabb(editor_state.active_body, new_position, new_half_size);
+        tiles_mark_dirty(editor_state.active_body);
     }
 
     // Resizing an existing body
@@ -360,40 +515,36 @@ void level_editor_render(void) {
 
         compute_resized_aabb(editor_state.initial_position, editor_state.initial_size, starting_mouse_pos, current_mouse_pos, &new_position, &new_half_size);
 
-        Static_Body *static_body = physics_static_body_get(editor_state.active_body);
-        static_body->aabb.position[0] = new_position[0];
-        static_body->aabb.position[1] = new_position[1];
-        static_body->aabb.half_size[0] = new_half_size[0];
-        static_body->aabb.half_size[1] = new_half_size[1];
+        physics_static_body_set_aabb(editor_state.active_body, new_position, new_half_size);
+        tiles_mark_dirty(editor_state.active_body);
     }
 
     // Exit creation or resize mode on mouse release
     if (!global.input.mouseRightClick && editor_state.action == CREATING && editor_state.active_body != (usize)-1) {
        editor_state.action = IDLE;
+       physics_static_body_commit();
         // editor_state.active_body = (usize)-1;
     }
 
     if (!global.input.mouseRightClick && editor_state.action == RESIZING && editor_state.active_body != (usize)-1) {
         editor_state.action = IDLE;
+        physics_static_body_commit();
         // editor_state.active_body = (usize)-1;
     }
 
     // Select and move static bodies
     if (global.input.mouseLeftClick && editor_state.action != MOVING) {
-        for (usize i = 0; i < physics_static_body_count(); ++i) {
+        usize i = static_body_pick(mousePos_world, false);
+
+        editor_state.active_body = i;
+
+        if (i != (usize)-1) {
             Static_Body *static_body = physics_static_body_get(i);
 
-            if (physics_point_intersect_aabb(mousePos_world, static_body->aabb)) {
-                
-                editor_state.active_body = i;
-                editor_state.action = MOVING;
+            editor_state.action = MOVING;
 
-                editor_state.offset[0] = static_body->aabb.position[0] - mouseX_world;
-                editor_state.offset[1] = static_body->aabb.position[1] - mouseY_world;
-                break;
-            } else {
-                editor_state.active_body = (usize)-1;
-            }
+            editor_state.offset[0] = static_body->aabb.position[0] - mouseX_world;
+            editor_state.offset[1] = static_body->aabb.position[1] - mouseY_world;
         }
     }
 
@@ -403,15 +554,19 @@ void level_editor_render(void) {
     if (global.input.mouseLeftClick && editor_state.action == MOVING && editor_state.active_body != (usize)-1) {
         // Update the position of the active body
         Static_Body *static_body = physics_static_body_get(editor_state.active_body);
-        static_body->aabb.position[0] = mouseX_world + editor_state.offset[0];
-        static_body->aabb.position[1] = mouseY_world + editor_state.offset[1];
+        vec2 new_position = {mouseX_world + editor_state.offset[0], mouseY_world + editor_state.offset[1]};
+        physics_static_body_set_aabb(editor_state.active_body, new_position, static_body->aabb.half_size);
+        tiles_mark_dirty(editor_state.active_body);
     }
 
     if (!global.input.mouseLeftClick && editor_state.action == MOVING && editor_state.active_body != (usize)-1) {
         editor_state.action = IDLE;
+        physics_static_body_commit();
         // editor_state.active_body = (usize)-1;
     }
 
+    tiles_update(&global.sprite_sheet_tileset);
+
     for (u32 i = 0; i < editor_state.list_tiled_static_bodies->len; ++i) {
         Static_Body *static_body = physics_static_body_get(i);
         // Render static bodies with appropriate color or texture
@@ -426,9 +581,6 @@ void level_editor_render(void) {
                 append_standard_quad((f32 *)static_body, GREEN);
             }
         }         
-    
-    Tiled_Static_Body *tiled_static_body = array_list_get(editor_state.list_tiled_static_bodies, i);
-    render_tiled_static_body(static_body, &global.sprite_sheet_tileset, tiled_static_body->tile_coordinates.row, tiled_static_body->tile_coordinates.column);
 
     // Render the resize handle
     vec2 size_handle = {5, 5};
@@ -1,47 +1,100 @@
 #include "../util/util.h"
+#include "../util/slot_map.h"
 #include "entity.h"
 #include "../physics/physics.h"
 
-static Array_List *entity_list;
+static Slot_Map *entity_map;
+
+// Owning entity handle per body slot index, so physics callbacks can get
+// from a Hit back to the entity without scanning.
+static Array_List *body_owners;
 
 void entity_init(void) {
-    entity_list = array_list_create(sizeof(Entity), 0);
+    entity_map = slot_map_create(sizeof(Entity), 0);
+    body_owners = array_list_create(sizeof(usize), 0);
 };
 
-usize entity_create(vec2 position, vec2 size, vec2 velocity, f32 mass, u8 collision_layer, u8 collision_mask, bool is_kinematic, On_Hit on_hit, On_Hit_Static on_hit_static) {
-    usize id = entity_list->len;
+static void body_owner_set(usize body_id, usize entity_id) {
+    u32 index = slot_map_index(body_id);
+    usize none = SLOT_MAP_INVALID;
 
-    // Find inactive Entity
+    while (body_owners->len <= index) {
+        if (array_list_append(body_owners, &none) == (usize)-1) {
+            ERROR_EXIT("Could not append body owner to list\n");
+        };
+    };
 
-    for (usize i = 0; i < entity_list->len; ++i) {
-        Entity *entity = array_list_get(entity_list, i);
+    *(usize *)array_list_get(body_owners, index) = entity_id;
+};
 
-        if (!entity->is_active) {
-            id = i;
-            break;
-        };
-    }
+usize entity_create(vec2 position, vec2 size, vec2 velocity, f32 mass, u8 collision_layer, u8 collision_mask, bool is_kinematic, On_Hit on_hit, On_Hit_Static on_hit_static) {
+    Entity entity = {
+        .body_id = physics_body_create(position, size, velocity, mass, collision_layer, collision_mask, is_kinematic, on_hit, on_hit_static),
+        .animation_id = (usize)-1,
+        .is_active = true,
+    };
 
-    if (id == entity_list->len) {
-        if (array_list_append(entity_list, &(Entity){0}) == (usize)-1) {
-            ERROR_EXIT("Could not append entity to list\n");
-        }
+    usize id = slot_map_insert(entity_map, &entity);
+
+    if (id == SLOT_MAP_INVALID) {
+        ERROR_EXIT("Could not append entity to list\n");
     }
 
+    body_owner_set(entity.body_id, id);
+
+    return id;
+};
+
+// Removes the entity and the body it owns. The animation is left alone since
+// several entities may share one.
+void entity_destroy(usize id) {
     Entity *entity = entity_get(id);
 
-    *entity = (Entity){
-        .body_id = physics_body_create(position, size, velocity, mass, collision_layer, collision_mask, is_kinematic, on_hit, on_hit_static),
-        .animation_id = (usize)-1,
-        .is_active = true,
-    }; 
+    if (entity == NULL) {
+        fprintf(stderr, "Entity %zu not found\n", id);
+        return;
+    };
+
+    body_owner_set(entity->body_id, SLOT_MAP_INVALID);
+    physics_body_remove(entity->body_id);
+    slot_map_remove(entity_map, id);
+};
+
+// Returns the entity owning the body, or SLOT_MAP_INVALID if the body is not
+// owned by a live entity.
+usize entity_from_body(usize body_id) {
+    u32 index = slot_map_index(body_id);
+
+    if (index >= body_owners->len) {
+        return SLOT_MAP_INVALID;
+    };
+
+    usize id = *(usize *)array_list_get(body_owners, index);
+    Entity *entity = entity_get(id);
+
+    // The slot may have been reused by a body with a different generation.
+    if (entity == NULL || entity->body_id != body_id) {
+        return SLOT_MAP_INVALID;
+    };
 
     return id;
 };
 
+// Returns NULL once the entity has been destroyed, even if its slot was
+// reused.
 Entity *entity_get(usize id) {
-    return array_list_get(entity_list, id);
+    return slot_map_get(entity_map, id);
+};
+
+// Slot-order access for iterating: returns NULL for free slots.
+Entity *entity_at(usize index) {
+    return slot_map_at(entity_map, index);
 };
+
+usize entity_handle_at(usize index) {
+    return slot_map_handle_at(entity_map, index);
+};
+
 usize entity_count() {
-    return entity_list->len;
-};
\ No newline at end of file
+    return slot_map_len(entity_map);
+};
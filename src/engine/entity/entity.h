@@ -13,5 +13,9 @@ typedef struct entity {
 
 void entity_init(void);
 usize entity_create(vec2 position, vec2 size, vec2 velocity, f32 mass, u8 collision_layer, u8 collision_mask, bool is_kinematic, On_Hit on_hit, On_Hit_Static on_hit_static);
+void entity_destroy(usize id);
+usize entity_from_body(usize body_id);
 Entity *entity_get(usize id);
+Entity *entity_at(usize index);
+usize entity_handle_at(usize index);
 usize entity_count();
\ No newline at end of file
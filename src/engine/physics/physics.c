@@ -1,16 +1,15 @@
 
+#include <stdlib.h>
+#include <string.h>
 #include <linmath.h>
-#include "../global.h"
 #include "../util/util.h"
+#include "../util/slot_map.h"
 #include "../io/io.h"
 #include "physics.h"
 #include "physics_internal.h"
 
 static Physics_State_Internal state;
 
-static u32 iterations = 4;
-static f32 tick_rate;
-
 void aabb_min_max(vec2 min, vec2 max, AABB aabb) {
     vec2_sub(min, aabb.position, aabb.half_size);
     vec2_add(max, aabb.position, aabb.half_size);
@@ -112,267 +111,1454 @@ bool physics_point_intersect_aabb(vec2 point, AABB aabb) {
            point[1] <= max[1];
 };
 
+static void physics_job_init(Physics_Job *job) {
+    *job = (Physics_Job){
+        .candidates = array_list_create(sizeof(u32), 64),
+        .contacts = array_list_create(sizeof(Physics_Contact), 0),
+    };
+};
+
 void physics_init(void) {
-    state.body_list = array_list_create(sizeof(Body), 0);
+    state.body_map = slot_map_create(sizeof(Body), 0);
     state.static_body_list = array_list_create(sizeof(Static_Body), 0);
+    state.jobs = array_list_create(sizeof(Physics_Job), 0);
+    state.snapshot = array_list_create(sizeof(Body), 0);
+    state.step_handles = array_list_create(sizeof(usize), 0);
+    state.ended_pairs = array_list_create(sizeof(Contact_Pair), 0);
+    physics_pairs_init(&state.pairs);
+    state.trigger_map = slot_map_create(sizeof(Trigger), 0);
+    state.trigger_events = array_list_create(sizeof(Trigger_Event), 0);
+    physics_pairs_init(&state.trigger_pairs);
+    state.snapshots = malloc(PHYSICS_SNAPSHOT_COUNT * sizeof(Physics_Snapshot));
+    if (!state.snapshots) {
+        ERROR_EXIT("Could not allocate memory for physics snapshots\n");
+    };
+    for (u32 i = 0; i < PHYSICS_SNAPSHOT_COUNT; ++i) {
+        physics_snapshot_init(&state.snapshots[i]);
+    };
+    state.snapshot_frame = 0;
+    state.static_revision = ++state.last_revision;
+    physics_job_init(&state.main_job);
+    physics_job_init(&state.query_job);
 
-    state.gravity = -100;
-    state.terminal_velocity = -7000;
+    for (u32 i = 0; i < PHYSICS_BODY_GRID_COUNT; ++i) {
+        physics_grid_init(&state.body_grids[i], PHYSICS_GRID_CELL_SIZE, PHYSICS_GRID_BUCKET_COUNT);
+    };
+    state.body_grid_bits = array_list_create(sizeof(u16), 0);
+    physics_grid_init(&state.static_grid, PHYSICS_GRID_CELL_SIZE, PHYSICS_GRID_BUCKET_COUNT);
+    physics_grid_init(&state.trigger_grid, PHYSICS_GRID_CELL_SIZE, PHYSICS_GRID_BUCKET_COUNT);
+    physics_bvh_init(&state.static_tree);
+    physics_colliders_init(&state.static_colliders);
 
-    tick_rate = 1.f / iterations;
+    state.gravity = -6000;
+    state.terminal_velocity = -7000;
+    state.fixed_step = 0;
+    state.max_steps = 1;
+    state.accumulator = 0;
+    state.alpha = 1;
+    state.worker_count = 0;
+    state.job_pool = NULL;
+    state.lod_focus_count = 0;
+    state.lod_near_radius = 512;
+    state.lod_far_radius = 0;
+    state.lod_far_interval = 4;
+    state.lod_step = 0;
 };
 
-static void update_sweep_result(Hit *result, Body *body, usize other_id, vec2 velocity) {
+static void swept_min_max(vec2 min, vec2 max, AABB aabb, vec2 velocity) {
+    aabb_min_max(min, max, aabb);
+
+    for (u8 i = 0; i < 2; ++i) {
+        if (velocity[i] < 0) {
+            min[i] += velocity[i];
+        } else {
+            max[i] += velocity[i];
+        }
+    }
+}
+
+static void sweep_result_update(Physics_Job *job, Hit *result, Hit hit, usize other_id, vec2 velocity) {
+    if (!hit.is_hit) {
+        return;
+    }
+
+    ++job->stats.hits;
+    hit.other_id = other_id;
+
+    if (hit.time < result->time) {
+        *result = hit;
+    } else if (hit.time == result->time) {
+        // Solve highest velocity axis first, then lowest id so the result
+        // does not depend on the order candidates come out of the broadphase.
+        bool prefer_hit = (fabsf(velocity[0]) > fabsf(velocity[1]) && hit.normal[0] != 0) ||
+                          (fabsf(velocity[1]) > fabsf(velocity[0]) && hit.normal[1] != 0);
+        bool prefer_result = (fabsf(velocity[0]) > fabsf(velocity[1]) && result->normal[0] != 0) ||
+                             (fabsf(velocity[1]) > fabsf(velocity[0]) && result->normal[1] != 0);
+
+        if (prefer_hit > prefer_result || (prefer_hit == prefer_result && other_id < result->other_id)) {
+            *result = hit;
+        }
+    }
+}
+
+static Body *body_at(u32 index) {
+    return slot_map_at(state.body_map, index);
+}
+
+static u32 layer_grid_bits(u8 collision_layer) {
+    return collision_layer != 0 ? collision_layer : 1u << PHYSICS_LAYER_COUNT;
+}
+
+// Puts the body at `index` in the grids of `grid_bits` and takes it out of
+// the others.
+static void body_grids_set(u32 index, u32 grid_bits, AABB aabb) {
+    while (state.body_grid_bits->len <= index) {
+        if (array_list_append(state.body_grid_bits, &(u16){0}) == (usize)-1) {
+            ERROR_EXIT("Could not append grid bits to list\n");
+        };
+    };
+
+    u16 *bits = (u16 *)state.body_grid_bits->items + index;
+    u32 removed = *bits & ~grid_bits;
+
+    for (u32 i = 0; removed != 0; ++i, removed >>= 1) {
+        if (removed & 1) {
+            physics_grid_remove(&state.body_grids[i], index);
+        }
+    }
+
+    for (u32 i = 0, added = grid_bits; added != 0; ++i, added >>= 1) {
+        if (added & 1) {
+            physics_grid_update(&state.body_grids[i], index, aabb);
+        }
+    }
+
+    *bits = (u16)grid_bits;
+}
+
+static void body_grids_remove(u32 index) {
+    if (index < state.body_grid_bits->len) {
+        body_grids_set(index, 0, (AABB){0});
+    }
+}
+
+static void body_grids_update(u32 index, Body *body, AABB aabb) {
+    body_grids_set(index, layer_grid_bits(body->collision_layer), aabb);
+}
+
+// Velocity the body will move with this step, once forces are applied.
+static void body_next_velocity(vec2 out, Body *body, f32 dt) {
+    out[0] = body->velocity[0] + body->acceleration[0] * dt;
+    out[1] = body->velocity[1];
+
+    if (!body->is_kinematic) {
+        out[1] += state.gravity * dt;
+        if (state.terminal_velocity > out[1]) {
+            out[1] = state.terminal_velocity;
+        }
+    }
+
+    out[1] += body->acceleration[1] * dt;
+}
+
+// Static ids in sweeps, hits and queries name colliders: the compiled ones
+// once committed, the authored bodies one to one while the tree is dirty.
+static Static_Body *static_collider_at(usize id) {
+    if (state.static_tree.is_dirty) {
+        return physics_static_body_get(id);
+    }
+    return array_list_get(state.static_colliders.bodies, id);
+}
+
+static void body_wake(Body *body) {
+    body->is_sleeping = false;
+    body->still_steps = 0;
+}
+
+static void body_sleep(Body *body) {
+    body->is_sleeping = true;
+    body->velocity[0] = 0;
+    body->velocity[1] = 0;
+    // Settle here so the step-start check does not read the last sub-step
+    // of motion as the body being moved.
+    body->previous_position[0] = body->aabb.position[0];
+    body->previous_position[1] = body->aabb.position[1];
+    ++state.sleeping_count;
+    state.sleeping_grids |= layer_grid_bits(body->collision_layer);
+    state.sleeping_mask |= body->collision_mask;
+}
+
+// Picks the body's tier from its distance to the nearest focus point.
+static void body_lod_update(Body *body) {
+    if (state.lod_focus_count == 0) {
+        body->lod = PHYSICS_LOD_NEAR;
+        return;
+    }
+
+    f32 distance = INFINITY;
+    for (u32 i = 0; i < state.lod_focus_count; ++i) {
+        f32 x = body->aabb.position[0] - state.lod_focus[i][0];
+        f32 y = body->aabb.position[1] - state.lod_focus[i][1];
+        distance = fminf(distance, x * x + y * y);
+    }
+
+    f32 margin = (1 + PHYSICS_LOD_HYSTERESIS) * (1 + PHYSICS_LOD_HYSTERESIS);
+    f32 near = state.lod_near_radius * state.lod_near_radius;
+    f32 far = state.lod_far_radius * state.lod_far_radius;
+
+    if (distance <= near * (body->lod == PHYSICS_LOD_NEAR ? margin : 1)) {
+        body->lod = PHYSICS_LOD_NEAR;
+    } else if (state.lod_far_radius <= 0 || distance <= far * (body->lod != PHYSICS_LOD_FROZEN ? margin : 1)) {
+        body->lod = PHYSICS_LOD_FAR;
+    } else {
+        body->lod = PHYSICS_LOD_FROZEN;
+    }
+}
+
+// Whether the body steps in this step. Far bodies take turns by slot.
+static bool body_lod_runs(Body *body, u32 index) {
+    if (body->lod == PHYSICS_LOD_NEAR) {
+        return true;
+    }
+    if (body->lod == PHYSICS_LOD_FROZEN) {
+        return false;
+    }
+    return (state.lod_step + index) % state.lod_far_interval == 0;
+}
+
+// Wakes sleeping bodies touching the region. Used when the static bodies
+// under them change.
+static void wake_region(vec2 min, vec2 max) {
+    if (state.sleeping_count == 0) {
+        return;
+    }
+
+    physics_grid_query_set(state.body_grids, state.sleeping_grids, min, max, state.main_job.candidates);
+
+    u32 *candidates = state.main_job.candidates->items;
+    for (usize i = 0; i < state.main_job.candidates->len; ++i) {
+        Body *other = body_at(candidates[i]);
+
+        if (other == NULL || !other->is_sleeping) {
+            continue;
+        }
+
+        vec2 other_min, other_max;
+        aabb_min_max(other_min, other_max, other->aabb);
+
+        if (other_min[0] <= max[0] && other_max[0] >= min[0] &&
+            other_min[1] <= max[1] && other_max[1] >= min[1]) {
+            body_wake(other);
+        }
+    }
+}
+
+// Wakes sleeping bodies the awake body at `index` touches and could
+// interact with in either direction.
+static void wake_touching(u32 index) {
+    if (state.sleeping_count == 0) {
+        return;
+    }
+
+    Body *body = body_at(index);
+
+    // Sleepers on layers outside the body's mask can only be touched if
+    // some sleeper's mask names the body's layer.
+    u32 grids = state.sleeping_grids;
+    if ((state.sleeping_mask & body->collision_layer) == 0) {
+        grids &= body->collision_mask;
+    }
+
+    if (grids == 0) {
+        return;
+    }
 
-    Body *other = physics_body_get(other_id);
+    vec2 min, max;
+    aabb_min_max(min, max, body->aabb);
+    physics_grid_query_set(state.body_grids, grids, min, max, state.main_job.candidates);
+
+    u32 *candidates = state.main_job.candidates->items;
+    for (usize i = 0; i < state.main_job.candidates->len; ++i) {
+        Body *other = body_at(candidates[i]);
+
+        if (other == NULL || !other->is_sleeping) {
+            continue;
+        }
+
+        if ((body->collision_mask & other->collision_layer) == 0 &&
+            (other->collision_mask & body->collision_layer) == 0) {
+            continue;
+        }
+
+        if (physics_aabb_intersect_aabb(body->aabb, other->aabb)) {
+            body_wake(other);
+        }
+    }
+}
+
+// Where the other body starts the step and how far it goes. Bodies that
+// already moved report what they did, bodies the LOD holds back stay put,
+// and the rest are assumed to keep their velocity.
+static void other_motion(vec2 start, vec2 displacement, Body *other, u32 other_index, Sweep_Window *window) {
+    if (!body_lod_runs(other, other_index)) {
+        start[0] = other->aabb.position[0];
+        start[1] = other->aabb.position[1];
+        displacement[0] = 0;
+        displacement[1] = 0;
+    } else if (other_index < window->moved_below) {
+        start[0] = other->previous_position[0];
+        start[1] = other->previous_position[1];
+        vec2_sub(displacement, other->aabb.position, other->previous_position);
+    } else {
+        start[0] = other->aabb.position[0];
+        start[1] = other->aabb.position[1];
+        body_next_velocity(displacement, other, window->dt);
+        vec2_scale(displacement, displacement, window->dt);
+    }
+}
 
+// Sweeps against the other body moving over the same part of the step, so
+// two fast bodies heading at each other cannot pass through. The ray runs
+// in the other body's frame; the reported position is the body's own.
+static void update_sweep_result(Physics_Job *job, Hit *result, Body *body, Body *other, u32 other_index, vec2 velocity, Sweep_Window *window) {
     if ((body->collision_mask & other->collision_layer) == 0) {
         return;
     }
 
+    ++job->stats.candidate_pairs;
+
+    vec2 start, displacement, relative;
+    other_motion(start, displacement, other, other_index, window);
+
     AABB sum_aabb = other->aabb;
     vec2_add(sum_aabb.half_size, sum_aabb.half_size, body->aabb.half_size);
+    sum_aabb.position[0] = start[0] + displacement[0] * window->start;
+    sum_aabb.position[1] = start[1] + displacement[1] * window->start;
 
-    Hit hit = ray_intersect_aabb(body->aabb.position, velocity, sum_aabb);
+    relative[0] = velocity[0] - displacement[0] * window->span;
+    relative[1] = velocity[1] - displacement[1] * window->span;
+
+    Hit hit = ray_intersect_aabb(body->aabb.position, relative, sum_aabb);
 
     if (hit.is_hit) {
-        if (body->on_hit && (body->collision_mask & other->collision_layer) == 0) {
-            body->on_hit(body, other, hit);
-        };
-        if (hit.time < result->time) {
-            *result = hit;
-        } else if (hit.time == result->time) {
-            // Solve highest velocity axis first.
-            if (fabsf(velocity[0]) > fabsf(velocity[1]) && hit.normal[0] != 0) {
-                *result = hit;
-            } else if (fabsf(velocity[1]) > fabsf(velocity[0]) && hit.normal[1] != 0) {
-                *result = hit;
-            }
-        }
-        result->other_id = other_id;
+        f32 time = fmaxf(hit.time, 0);
+        hit.position[0] = body->aabb.position[0] + velocity[0] * time;
+        hit.position[1] = body->aabb.position[1] + velocity[1] * time;
     }
+
+    sweep_result_update(job, result, hit, other_index, relative);
 }
 
-static void update_sweep_result_static(Hit *result, Body *body, usize other_id, vec2 velocity) {
+static void update_sweep_result_static(Physics_Job *job, Hit *result, Body *body, usize other_id, vec2 velocity) {
 
-    Static_Body *static_body = physics_static_body_get(other_id);
+    Static_Body *static_body = static_collider_at(other_id);
 
     if ((body->collision_mask & static_body->collision_layer) == 0) {
         return;
     }
 
+    ++job->stats.candidate_pairs;
+
     AABB sum_aabb = static_body->aabb;
     vec2_add(sum_aabb.half_size, sum_aabb.half_size, body->aabb.half_size);
 
-    Hit hit = ray_intersect_aabb(body->aabb.position, velocity, sum_aabb);
+    sweep_result_update(job, result, ray_intersect_aabb(body->aabb.position, velocity, sum_aabb), other_id, velocity);
+}
 
-    if (hit.is_hit) {
-        if (hit.time < result->time) {
-            *result = hit;
-        } else if (hit.time == result->time) {
-            // Solve highest velocity axis first.
-            if (fabsf(velocity[0]) > fabsf(velocity[1]) && hit.normal[0] != 0) {
-                *result = hit;
-            } else if (fabsf(velocity[1]) > fabsf(velocity[0]) && hit.normal[1] != 0) {
-                *result = hit;
-            }
-        }
-        result->other_id = other_id;
-    }
+// Called for static bodies the sweep kernel already reported as hits, so it
+// only rebuilds the Hit and applies the tie-break.
+static void visit_static_hit(Physics_Job *job, Hit *result, Body *body, usize other_id, vec2 velocity) {
+    Static_Body *static_body = static_collider_at(other_id);
+
+    AABB sum_aabb = static_body->aabb;
+    vec2_add(sum_aabb.half_size, sum_aabb.half_size, body->aabb.half_size);
+
+    sweep_result_update(job, result, ray_intersect_aabb(body->aabb.position, velocity, sum_aabb), other_id, velocity);
 }
 
-static Hit sweep_static_bodies(Body *body, vec2 velocity) {
+static Hit sweep_static_bodies(Physics_Job *job, Body *body, vec2 velocity) {
     Hit result = {.time = 0xBEEF};
 
-    for (u32 i = 0; i < state.static_body_list->len; ++i) {
-        Static_Body *static_body = physics_static_body_get(i);
-        update_sweep_result_static(&result, body, i, velocity);
+    if (!state.static_tree.is_dirty) {
+        job->stats.candidate_pairs += physics_bvh_sweep(&state.static_tree, job, body, velocity, &result, visit_static_hit);
+        return result;
+    }
+
+    vec2 min, max;
+    swept_min_max(min, max, body->aabb, velocity);
+    physics_grid_query(&state.static_grid, min, max, job->candidates);
+
+    u32 *candidates = job->candidates->items;
+    for (usize i = 0; i < job->candidates->len; ++i) {
+        update_sweep_result_static(job, &result, body, candidates[i], velocity);
     }
     return result;
 }
 
-static Hit sweep_bodies(Body *other, vec2 velocity) {
+// `bodies` is indexed by slot: the live bodies, or the snapshot taken at the
+// start of a two-phase step. Removed bodies are never active. Grid entries
+// cover each body's whole move, so bodies coming in from outside the swept
+// area are found too.
+static Hit sweep_bodies(Physics_Job *job, u32 index, Body *body, vec2 velocity, Body *bodies, Sweep_Window *window) {
     Hit result = {.time = 0xBEEF};
 
-    for (u32 i = 0; i < state.body_list->len; ++i) {
-        Body *body = physics_body_get(i);   
+    vec2 min, max;
+    swept_min_max(min, max, body->aabb, velocity);
+    physics_grid_query_set(state.body_grids, body->collision_mask, min, max, job->candidates);
+
+    u32 *candidates = job->candidates->items;
+    for (usize i = 0; i < job->candidates->len; ++i) {
+        Body *other = &bodies[candidates[i]];
 
-        if (body == other) {
+        if (candidates[i] == index || !other->is_active) {
             continue;
         };
 
-        update_sweep_result(&result, body, i, velocity);
+        update_sweep_result(job, &result, body, other, candidates[i], velocity, window);
     }
     return result;
 }
 
-static void sweep_response(Body *body, vec2 velocity) {
-    Hit hit = sweep_static_bodies(body, velocity);
-    Hit hit_moving = sweep_bodies(body, velocity);
+static void static_hit_apply(Body *body, Hit hit, vec2 velocity) {
+    body->aabb.position[0] = hit.position[0];
+    body->aabb.position[1] = hit.position[1];
 
-    if (hit_moving.is_hit) {
-        if (body->on_hit != NULL) {
-            body->on_hit(body, physics_body_get(hit_moving.other_id), hit_moving);
-        }
+    if (hit.normal[0] != 0) {
+        body->aabb.position[1] += velocity[1];
+        body->velocity[0] = 0;
+    } else if (hit.normal[1] != 0) {
+        body->aabb.position[0] += velocity[0];
+        body->velocity[1] = 0;
     }
+}
 
-    if (hit.is_hit) {
-        body->aabb.position[0] = hit.position[0];
-        body->aabb.position[1] = hit.position[1];
+// Runs the body's callback for a contact, once per pair per step and only
+// for the events it subscribed to. Pairs are tracked even when the event is
+// filtered, so end events still arrive.
+static void contact_report(usize handle, usize other_id, Hit hit, bool is_static) {
+    Body *body = slot_map_get(state.body_map, handle);
+
+    if ((is_static ? (void *)body->on_hit_static : (void *)body->on_hit) == NULL) {
+        return;
+    }
+
+    u8 event = physics_pairs_touch(&state.pairs, handle, other_id, is_static);
+
+    if ((body->contact_events & event) == 0) {
+        return;
+    }
+
+    hit.event = event;
+
+    if (is_static) {
+        body->on_hit_static(body, static_collider_at(other_id), hit);
+        return;
+    }
+
+    body->on_hit(body, slot_map_get(state.body_map, other_id), hit);
+
+    // Callbacks may remove bodies or grow the body storage.
+    body = slot_map_get(state.body_map, handle);
+    if (body != NULL) {
+        body->still_steps = 0;
+    }
+}
+
+// Pairs that stopped touching get their end event after the step, with
+// every body in its final place.
+static void contacts_end(void) {
+    physics_pairs_advance(&state.pairs, state.ended_pairs);
+
+    Contact_Pair *pairs = state.ended_pairs->items;
+    for (usize i = 0; i < state.ended_pairs->len; ++i) {
+        Body *body = slot_map_get(state.body_map, pairs[i].self);
+
+        if (body == NULL) {
+            continue;
+        }
+
+        // Sleeping and held bodies did not step, so their contacts carry on
+        // until they move away.
+        if (body->is_active && (body->is_sleeping || !body_lod_runs(body, slot_map_index(pairs[i].self)))) {
+            physics_pairs_keep(&state.pairs, &pairs[i]);
+            continue;
+        }
 
-        if (hit.normal[0] != 0) {
-            body->aabb.position[1] += velocity[1];
-            body->velocity[0] = 0;
-        } else if (hit.normal[1] != 0) {
-            body->aabb.position[0] += velocity[0];
-            body->velocity[1] = 0;
+        if ((body->contact_events & CONTACT_EVENT_END) == 0) {
+            continue;
         }
 
-        if (body->on_hit_static != NULL) {
-            body->on_hit_static(body, physics_static_body_get(hit.other_id), hit);
+        Hit hit = {.other_id = pairs[i].other, .event = CONTACT_EVENT_END};
+
+        if (pairs[i].is_static) {
+            if (body->on_hit_static != NULL && pairs[i].other < physics_static_collider_count()) {
+                body->on_hit_static(body, static_collider_at(pairs[i].other), hit);
+            }
+        } else if (body->on_hit != NULL) {
+            body->on_hit(body, slot_map_get(state.body_map, pairs[i].other), hit);
         }
+    }
+}
+
+static void static_bodies_query(vec2 min, vec2 max, Array_List *out) {
+    if (state.static_tree.is_dirty) {
+        physics_grid_query(&state.static_grid, min, max, out);
     } else {
-        vec2_add(body->aabb.position, body->aabb.position, velocity);
+        physics_bvh_query(&state.static_tree, min, max, out);
     }
 }
 
-static void stationary_response(Body *body) {
-    for (u32 i = 0; i < state.static_body_list->len; ++i) {
-        Static_Body *static_body = physics_static_body_get(i);
+static void static_push_out(Physics_Job *job, Body *body) {
+    vec2 min, max;
+    aabb_min_max(min, max, body->aabb);
+    static_bodies_query(min, max, job->candidates);
+
+    u32 *candidates = job->candidates->items;
+    for (usize i = 0; i < job->candidates->len; ++i) {
+        Static_Body *static_body = static_collider_at(candidates[i]);
+
+        ++job->stats.candidate_pairs;
 
         AABB aabb = aabb_minkowski_difference(static_body->aabb, body->aabb);
-        vec2 min, max;
         aabb_min_max(min, max, aabb);
 
         if (min[0] <= 0 && max[0] >= 0 && min[1] <= 0 && max[1] >= 0) {
+            ++job->stats.hits;
+
             vec2 penetration_vector;
             aabb_penetration_vector(penetration_vector, aabb);
 
             vec2_add(body->aabb.position, body->aabb.position, penetration_vector);
         }
     }
+}
 
-    // Check for on-hit events
+// Grid entries span the whole move from `position` by `displacement`, so a
+// sweep finds every body that crosses its path during the step.
+static void grid_update_swept(u32 index, Body *body, vec2 position, vec2 displacement) {
+    AABB aabb = {
+        .position = {position[0] + displacement[0] * 0.5f, position[1] + displacement[1] * 0.5f},
+        .half_size = {body->aabb.half_size[0] + fabsf(displacement[0]) * 0.5f, body->aabb.half_size[1] + fabsf(displacement[1]) * 0.5f},
+    };
+    body_grids_update(index, body, aabb);
+}
 
-    for (usize i = 0; i < state.body_list->len; ++i) {
-        Body *other = physics_body_get(i);
+// Gameplay code moves, deactivates and removes bodies directly, so pick
+// those changes up before anything queries the grid.
+static void refresh_bodies(f32 dt) {
+    state.sleeping_count = 0;
+    state.sleeping_grids = 0;
+    state.sleeping_mask = 0;
 
-        if (!body->on_hit) {
-            continue;
-        };
+    for (u32 i = 0; i < slot_map_len(state.body_map); ++i) {
+        Body *body = body_at(i);
 
-        if ((body->collision_mask & other->collision_layer) == 0) {
+        if (body == NULL) {
+            body_grids_remove(i);
             continue;
         };
 
-        AABB aabb = aabb_minkowski_difference(other->aabb, body->aabb);
-        vec2 min, max;
-        aabb_min_max(min, max, aabb);
-
-        if (min[0] <= 0 && max[0] >= 0 && min[1] <= 0 && max[1] >= 0) {
-            body->on_hit(body, other, (Hit){.is_hit = true, .other_id = i});
-        }
-    }
-};
-
-void physics_update(void) {
-    Body *body;
+        if (body->is_sleeping) {
+            if (body->velocity[0] != 0 || body->velocity[1] != 0 ||
+                body->aabb.position[0] != body->previous_position[0] ||
+                body->aabb.position[1] != body->previous_position[1]) {
+                body_wake(body);
+            } else {
+                ++state.sleeping_count;
+                state.sleeping_grids |= layer_grid_bits(body->collision_layer);
+                state.sleeping_mask |= body->collision_mask;
+            }
+        };
 
-    for (u32 i = 0; i < state.body_list->len; ++i) {
-        body = array_list_get(state.body_list, i);
+        body->previous_position[0] = body->aabb.position[0];
+        body->previous_position[1] = body->aabb.position[1];
 
         if (!body->is_active) {
+            body_grids_remove(i);
             continue;
-        };
+        }
 
-        if (!body->is_kinematic) {
-            body->velocity[1] += state.gravity;
-            if (state.terminal_velocity > body->velocity[1]) {
-                body->velocity[1] = state.terminal_velocity;
-            }
+        if (body->is_sleeping) {
+            body_grids_update(i, body, body->aabb);
+            continue;
         }
 
-        body->velocity[0] += body->acceleration[0];
-        body->velocity[1] += body->acceleration[1];
+        // Far bodies bank the steps they sit out; frozen ones lose them.
+        body_lod_update(body);
 
-        vec2 scaled_velocity;
-        vec2_scale(scaled_velocity, body->velocity, global.time.delta * tick_rate);
+        if (body->lod != PHYSICS_LOD_FROZEN) {
+            body->lod_dt += dt;
+        }
 
-        for (u32 j = 0; j < iterations; ++j) {
-            sweep_response(body, scaled_velocity);
-            stationary_response(body);
-        } 
+        if (!body_lod_runs(body, i)) {
+            body_grids_update(i, body, body->aabb);
+        } else {
+            vec2 velocity;
+            body_next_velocity(velocity, body, body->lod_dt);
+            vec2_scale(velocity, velocity, body->lod_dt);
+            grid_update_swept(i, body, body->aabb.position, velocity);
+        }
     };
-};
-usize physics_body_create(vec2 position, vec2 size, vec2 velocity, f32 mass, u8 collision_layer, u8 collision_mask, bool is_kinematic, On_Hit on_hit, On_Hit_Static on_hit_static) {
-    usize id = state.body_list->len;
+}
 
-    for (usize i = 0; i < state.body_list->len; ++i) {
-        Body *body = array_list_get(state.body_list, i);
-        if (!body->is_active) {
-            id = i;
-            break;
-        };
-    }
+// Only bodies covering a good part of their own size in one step are split
+// up; the sweeps themselves are continuous, so sub-steps just give sliding
+// and push-out more chances to catch a second contact.
+static u32 substep_count(Body *body, vec2 displacement) {
+    f32 count = 1;
+
+    for (u8 i = 0; i < 2; ++i) {
+        if (displacement[i] == 0) {
+            continue;
+        }
 
-    if (id == state.body_list->len) {
-        if (array_list_append(state.body_list, &(Body){0}) == (usize)-1) {
-            ERROR_EXIT("Could not append body to list\n");
+        f32 limit = body->aabb.half_size[i] * PHYSICS_SUBSTEP_FRACTION;
+        if (limit <= 0) {
+            return PHYSICS_MAX_SUBSTEPS;
         }
+        count = fmaxf(count, ceilf(fabsf(displacement[i]) / limit));
     }
 
-    Body *body = physics_body_get(id);
+    return (u32)fminf(count, PHYSICS_MAX_SUBSTEPS);
+}
 
-    //
-    *body = (Body){
-        .aabb = {
-            .position = {position[0], position[1]},
-            .half_size = {size[0] * 0.5, size[1] * 0.5},
-        },
-        .velocity = {velocity[0], velocity[1]},
-        .collision_layer = collision_layer,
-        .collision_mask = collision_mask,
-        .on_hit = on_hit,
-        .on_hit_static = on_hit_static,
-        .is_kinematic = is_kinematic,
-        .is_active = true,
-        .mass = mass,
-    };
+// Applies forces, then sets scaled_velocity to the distance covered in each
+// sub-step and returns how many there are.
+static u32 body_integrate(Physics_Job *job, Body *body, f32 dt, vec2 scaled_velocity) {
+    body_next_velocity(body->velocity, body, dt);
+    vec2_scale(scaled_velocity, body->velocity, dt);
 
-    return id;
-};
+    u32 substeps = substep_count(body, scaled_velocity);
+    vec2_scale(scaled_velocity, scaled_velocity, 1.f / substeps);
+    job->stats.substeps += substeps;
 
-Body *physics_body_get(usize index) {
-    return array_list_get(state.body_list, index);
-};
+    return substeps;
+}
 
-u8 physics_body_remove(usize index) {
-    return array_list_remove(state.body_list, index);
-};
+static void body_track_sleep(Body *body) {
+    f32 distance = fabsf(body->aabb.position[0] - body->previous_position[0]) +
+                   fabsf(body->aabb.position[1] - body->previous_position[1]);
+    f32 speed = fabsf(body->velocity[0]) + fabsf(body->velocity[1]);
 
-usize physics_static_body_create(vec2 position, vec2 size, u8 collision_layer) {
-    Static_Body static_body = {
-        .aabb = {
-            .position = {position[0], position[1]},
-            .half_size = {size[0] * 0.5, size[1] * 0.5},
-        },
-        .collision_layer = collision_layer,
-    };
+    if (distance < PHYSICS_SLEEP_DISTANCE && speed < PHYSICS_SLEEP_VELOCITY) {
+        if (++body->still_steps >= PHYSICS_SLEEP_STEPS) {
+            body_sleep(body);
+        }
+    } else {
+        body->still_steps = 0;
+    }
+}
 
-    if (array_list_append(state.static_body_list, &static_body) == -1) {
-        ERROR_EXIT("Could not apend static body to list\n");
+static void stats_collect(Physics_Job *job) {
+    state.stats.candidate_pairs += job->stats.candidate_pairs;
+    state.stats.hits += job->stats.hits;
+    state.stats.substeps += job->stats.substeps;
+    job->stats = (Physics_Stats){0};
+}
+
+static void job_contact_add(Physics_Job *job, u32 index, usize other_id, Hit hit, bool is_static) {
+    Physics_Contact contact = {
+        .index = index,
+        .other_id = other_id,
+        .hit = hit,
+        .is_static = is_static,
     };
-    return state.static_body_list->len - 1;
-};
 
+    if (array_list_append(job->contacts, &contact) == (usize)-1) {
+        ERROR_EXIT("Could not append contact to list\n");
+    };
+}
 
-Static_Body *physics_static_body_get(usize index) {
-    return array_list_get(state.static_body_list, index);
-};
+static void job_overlap_contacts(Physics_Job *job, u32 index, Body *body, Body *bodies) {
+    vec2 min, max;
+    aabb_min_max(min, max, body->aabb);
+    physics_grid_query_set(state.body_grids, body->collision_mask, min, max, job->candidates);
 
-int physics_static_body_dump(const char* path) {
-    size_t total_size = sizeof(Array_List) + state.static_body_list->capacity * state.static_body_list->item_size;
-    void *buffer = malloc(total_size);
+    u32 *candidates = job->candidates->items;
+    for (usize i = 0; i < job->candidates->len; ++i) {
+        Body *other = &bodies[candidates[i]];
+
+        if (candidates[i] == index || !other->is_active) {
+            continue;
+        };
+
+        if ((body->collision_mask & other->collision_layer) == 0) {
+            continue;
+        };
+
+        ++job->stats.candidate_pairs;
+
+        AABB aabb = aabb_minkowski_difference(other->aabb, body->aabb);
+        aabb_min_max(min, max, aabb);
+
+        if (min[0] <= 0 && max[0] >= 0 && min[1] <= 0 && max[1] >= 0) {
+            ++job->stats.hits;
+            Hit hit = {.is_hit = true, .other_id = slot_map_handle_at(state.body_map, candidates[i])};
+            job_contact_add(job, index, hit.other_id, hit, false);
+        }
+    }
+}
+
+// Integrates the body and moves it through its sub-steps, recording hits in
+// the job's contacts instead of calling back. `bodies` and `moved_below` are
+// as in sweep_bodies and Sweep_Window.
+static void body_move(Physics_Job *job, u32 index, Body *body, f32 dt, Body *bodies, u32 moved_below) {
+    vec2 scaled_velocity;
+    u32 substeps = body_integrate(job, body, dt, scaled_velocity);
+    Sweep_Window window = {.dt = dt, .span = 1.f / substeps, .moved_below = moved_below};
+
+    for (u32 j = 0; j < substeps; ++j) {
+        window.start = j * window.span;
+
+        Hit hit = sweep_static_bodies(job, body, scaled_velocity);
+        Hit hit_moving = sweep_bodies(job, index, body, scaled_velocity, bodies, &window);
+
+        if (hit_moving.is_hit) {
+            hit_moving.other_id = slot_map_handle_at(state.body_map, hit_moving.other_id);
+            job_contact_add(job, index, hit_moving.other_id, hit_moving, false);
+        }
+
+        if (hit.is_hit) {
+            static_hit_apply(body, hit, scaled_velocity);
+
+            if (body->on_hit_static != NULL) {
+                job_contact_add(job, index, hit.other_id, hit, true);
+            }
+        } else {
+            vec2_add(body->aabb.position, body->aabb.position, scaled_velocity);
+        }
+
+        static_push_out(job, body);
+
+        if (body->on_hit != NULL) {
+            job_overlap_contacts(job, index, body, bodies);
+        }
+    }
+}
+
+// Wakes the other body and reports the contact. `handle` is the body the
+// contact was recorded for.
+static void contact_dispatch(usize handle, Physics_Contact *contact) {
+    Body *body = slot_map_get(state.body_map, handle);
+
+    if (body == NULL) {
+        return;
+    }
+
+    if (contact->is_static) {
+        if (contact->other_id < physics_static_collider_count()) {
+            contact_report(handle, contact->other_id, contact->hit, true);
+        }
+        return;
+    }
+
+    Body *other = slot_map_get(state.body_map, contact->other_id);
+
+    if (other == NULL) {
+        return;
+    }
+
+    body_wake(other);
+    contact_report(handle, contact->other_id, contact->hit, false);
+}
+
+static void physics_step_serial(f32 dt) {
+    Body *body;
+
+    refresh_bodies(dt);
+
+    state.stats.awake_bodies = 0;
+    state.stats.sleeping_bodies = 0;
+    state.stats.held_bodies = 0;
+
+    for (u32 i = 0; i < slot_map_len(state.body_map); ++i) {
+        body = body_at(i);
+
+        if (body == NULL || !body->is_active) {
+            continue;
+        };
+
+        if (body->is_sleeping) {
+            ++state.stats.sleeping_bodies;
+            continue;
+        };
+
+        if (!body_lod_runs(body, i)) {
+            ++state.stats.held_bodies;
+            continue;
+        };
+
+        ++state.stats.awake_bodies;
+        usize handle = slot_map_handle_at(state.body_map, i);
+
+        state.main_job.contacts->len = 0;
+        body_move(&state.main_job, i, body, body->lod_dt, state.body_map->items->items, i);
+        body->lod_dt = 0;
+
+        // Callbacks run once the body is done moving, so what they set is
+        // not undone by a later sub-step.
+        Physics_Contact *contacts = state.main_job.contacts->items;
+        for (usize j = 0; j < state.main_job.contacts->len; ++j) {
+            contact_dispatch(handle, &contacts[j]);
+        }
+
+        body = slot_map_get(state.body_map, handle);
+
+        if (body == NULL || !body->is_active) {
+            body_grids_remove(i);
+            continue;
+        }
+
+        vec2 displacement;
+        vec2_sub(displacement, body->aabb.position, body->previous_position);
+        grid_update_swept(i, body, body->previous_position, displacement);
+        wake_touching(i);
+        body_track_sleep(body);
+    };
+
+    stats_collect(&state.main_job);
+};
+
+// Phase one of a two-phase step. Moves the job's bodies against the static
+// bodies and records hits instead of calling back. Other bodies are read
+// from the snapshot and the body grid is left alone, so a body's result does
+// not depend on which job or thread moved its neighbours.
+static void step_job(void *context, u32 job_index) {
+    (void)context;
+    Physics_Job *job = array_list_get(state.jobs, job_index);
+    usize *handles = state.step_handles->items;
+    Body *bodies = state.snapshot->items;
+
+    job->contacts->len = 0;
+
+    for (u32 i = job->first; i < job->last; ++i) {
+        if (handles[i] == SLOT_MAP_INVALID) {
+            continue;
+        };
+
+        Body *body = body_at(i);
+        body_move(job, i, body, body->lod_dt, bodies, 0);
+        body->lod_dt = 0;
+    }
+}
+
+// Bodies move in parallel against the read-only static bodies, then the
+// main thread replays dynamic contacts and callbacks in body order. Other
+// bodies are seen where they were at the start of the step, and callbacks
+// run after every body has moved, so results differ from the serial step
+// but not between worker counts.
+static void physics_step_two_phase(f32 dt) {
+    refresh_bodies(dt);
+
+    usize len = slot_map_len(state.body_map);
+    usize invalid = SLOT_MAP_INVALID;
+
+    while (state.snapshot->len < len) {
+        if (array_list_append(state.snapshot, &(Body){0}) == (usize)-1) {
+            ERROR_EXIT("Could not append body to snapshot\n");
+        };
+    };
+    while (state.step_handles->len < len) {
+        if (array_list_append(state.step_handles, &invalid) == (usize)-1) {
+            ERROR_EXIT("Could not append handle to list\n");
+        };
+    };
+
+    if (len > 0) {
+        memcpy(state.snapshot->items, state.body_map->items->items, len * sizeof(Body));
+    };
+
+    usize *handles = state.step_handles->items;
+
+    state.stats.awake_bodies = 0;
+    state.stats.sleeping_bodies = 0;
+    state.stats.held_bodies = 0;
+
+    for (u32 i = 0; i < len; ++i) {
+        Body *body = body_at(i);
+        handles[i] = SLOT_MAP_INVALID;
+
+        if (body == NULL || !body->is_active) {
+            continue;
+        };
+
+        if (body->is_sleeping) {
+            ++state.stats.sleeping_bodies;
+            continue;
+        };
+
+        if (!body_lod_runs(body, i)) {
+            ++state.stats.held_bodies;
+            continue;
+        };
+
+        ++state.stats.awake_bodies;
+        handles[i] = slot_map_handle_at(state.body_map, i);
+    };
+
+    u32 job_count = state.worker_count * PHYSICS_JOBS_PER_WORKER;
+
+    for (u32 j = 0; j < job_count; ++j) {
+        Physics_Job *job = array_list_get(state.jobs, j);
+        job->first = (u32)(len * j / job_count);
+        job->last = (u32)(len * (j + 1) / job_count);
+    };
+
+    job_pool_run(state.job_pool, step_job, NULL, job_count);
+
+    for (u32 j = 0; j < job_count; ++j) {
+        stats_collect(array_list_get(state.jobs, j));
+    };
+
+    for (u32 i = 0; i < len; ++i) {
+        if (handles[i] != SLOT_MAP_INVALID) {
+            body_grids_update(i, body_at(i), body_at(i)->aabb);
+        };
+    };
+
+    // Jobs cover increasing slot ranges, so this is body order.
+    for (u32 j = 0; j < job_count; ++j) {
+        Physics_Job *job = array_list_get(state.jobs, j);
+        Physics_Contact *contacts = job->contacts->items;
+
+        for (usize i = 0; i < job->contacts->len; ++i) {
+            contact_dispatch(handles[contacts[i].index], &contacts[i]);
+        };
+    };
+
+    for (u32 i = 0; i < len; ++i) {
+        Body *body = slot_map_get(state.body_map, handles[i]);
+
+        if (body == NULL) {
+            continue;
+        };
+
+        if (!body->is_active) {
+            body_grids_remove(i);
+            continue;
+        };
+
+        body_grids_update(i, body, body->aabb);
+        wake_touching(i);
+        body_track_sleep(body);
+    };
+}
+
+static void triggers_refresh(void) {
+    for (u32 i = 0; i < slot_map_len(state.trigger_map); ++i) {
+        Trigger *trigger = slot_map_at(state.trigger_map, i);
+
+        if (trigger == NULL || !trigger->is_active) {
+            physics_grid_remove(&state.trigger_grid, i);
+        } else {
+            physics_grid_update(&state.trigger_grid, i, trigger->aabb);
+        }
+    }
+}
+
+static void trigger_event_add(usize trigger, usize body, u8 event) {
+    Trigger_Event trigger_event = {
+        .trigger = trigger,
+        .body = body,
+        .event = event,
+    };
+
+    if (array_list_append(state.trigger_events, &trigger_event) == (usize)-1) {
+        ERROR_EXIT("Could not append trigger event to list\n");
+    };
+}
+
+// Overlap-only pass run after each step. Each body is tested over the whole
+// of its last move, so one crossing a small trigger inside a step still
+// counts. Events are queued until the end of the frame.
+static void triggers_collect(void) {
+    if (state.trigger_map->count == 0) {
+        return;
+    }
+
+    triggers_refresh();
+
+    for (u32 i = 0; i < slot_map_len(state.body_map); ++i) {
+        Body *body = body_at(i);
+
+        if (body == NULL || !body->is_active) {
+            continue;
+        }
+
+        vec2 min, max;
+        for (u8 j = 0; j < 2; ++j) {
+            min[j] = fminf(body->previous_position[j], body->aabb.position[j]) - body->aabb.half_size[j];
+            max[j] = fmaxf(body->previous_position[j], body->aabb.position[j]) + body->aabb.half_size[j];
+        }
+
+        physics_grid_query(&state.trigger_grid, min, max, state.main_job.candidates);
+
+        u32 *candidates = state.main_job.candidates->items;
+        for (usize j = 0; j < state.main_job.candidates->len; ++j) {
+            Trigger *trigger = slot_map_at(state.trigger_map, candidates[j]);
+
+            if ((trigger->collision_mask & body->collision_layer) == 0) {
+                continue;
+            }
+
+            vec2 trigger_min, trigger_max;
+            aabb_min_max(trigger_min, trigger_max, trigger->aabb);
+
+            if (trigger_min[0] > max[0] || trigger_max[0] < min[0] ||
+                trigger_min[1] > max[1] || trigger_max[1] < min[1]) {
+                continue;
+            }
+
+            usize trigger_id = slot_map_handle_at(state.trigger_map, candidates[j]);
+            usize body_id = slot_map_handle_at(state.body_map, i);
+            u8 event = physics_pairs_touch(&state.trigger_pairs, trigger_id, body_id, false);
+
+            if ((trigger->contact_events & event) != 0) {
+                trigger_event_add(trigger_id, body_id, event);
+            }
+        }
+    }
+}
+
+// Ends the frame's trigger pairs and runs every queued event in the order
+// it was found, end events last.
+static void triggers_dispatch(void) {
+    physics_pairs_advance(&state.trigger_pairs, state.ended_pairs);
+
+    Contact_Pair *pairs = state.ended_pairs->items;
+    for (usize i = 0; i < state.ended_pairs->len; ++i) {
+        Trigger *trigger = slot_map_get(state.trigger_map, pairs[i].self);
+
+        if (trigger != NULL && (trigger->contact_events & CONTACT_EVENT_END) != 0) {
+            trigger_event_add(pairs[i].self, pairs[i].other, CONTACT_EVENT_END);
+        }
+    }
+
+    Trigger_Event *events = state.trigger_events->items;
+    for (usize i = 0; i < state.trigger_events->len; ++i) {
+        // Earlier callbacks may have removed either side.
+        Trigger *trigger = slot_map_get(state.trigger_map, events[i].trigger);
+        Body *body = slot_map_get(state.body_map, events[i].body);
+
+        if (trigger == NULL || trigger->on_trigger == NULL || (body == NULL && events[i].event != CONTACT_EVENT_END)) {
+            continue;
+        }
+
+        Hit hit = {
+            .other_id = events[i].body,
+            .is_hit = events[i].event != CONTACT_EVENT_END,
+            .event = events[i].event,
+        };
+        trigger->on_trigger(trigger, body, hit);
+    }
+
+    state.trigger_events->len = 0;
+}
+
+static void physics_step(f32 dt) {
+    if (state.worker_count > 0) {
+        physics_step_two_phase(dt);
+    } else {
+        physics_step_serial(dt);
+    }
+
+    contacts_end();
+    triggers_collect();
+    ++state.lod_step;
+};
+
+void physics_update(f32 dt) {
+    // Body counts describe the last step, so they carry over frames where
+    // the accumulator runs no step.
+    state.stats = (Physics_Stats){
+        .awake_bodies = state.stats.awake_bodies,
+        .sleeping_bodies = state.stats.sleeping_bodies,
+        .held_bodies = state.stats.held_bodies,
+    };
+
+    if (state.fixed_step <= 0) {
+        physics_step(dt);
+        triggers_dispatch();
+        state.alpha = 1;
+        return;
+    };
+
+    state.accumulator += dt;
+
+    u32 steps = 0;
+    while (state.accumulator >= state.fixed_step && steps < state.max_steps) {
+        physics_step(state.fixed_step);
+        state.accumulator -= state.fixed_step;
+        ++steps;
+    };
+
+    // Trigger pairs only advance on frames that stepped, so a frame without
+    // a step does not end them.
+    if (steps > 0) {
+        triggers_dispatch();
+    };
+
+    // Drop whatever the catch-up limit could not simulate rather than
+    // carrying a growing backlog into the next frame.
+    if (state.accumulator >= state.fixed_step) {
+        state.accumulator = fmodf(state.accumulator, state.fixed_step);
+    };
+
+    state.alpha = state.accumulator / state.fixed_step;
+};
+
+void physics_set_fixed_timestep(f32 rate, u32 max_steps) {
+    state.fixed_step = rate > 0 ? 1.f / rate : 0;
+    state.max_steps = max_steps > 0 ? max_steps : 1;
+    state.accumulator = 0;
+    state.alpha = 1;
+};
+
+f32 physics_alpha(void) {
+    return state.alpha;
+};
+
+void physics_body_interpolated_position(usize id, vec2 out) {
+    Body *body = physics_body_get(id);
+
+    if (body == NULL) {
+        ERROR_EXIT("Body %zu not found\n", id);
+    };
+
+    out[0] = body->previous_position[0] + (body->aabb.position[0] - body->previous_position[0]) * state.alpha;
+    out[1] = body->previous_position[1] + (body->aabb.position[1] - body->previous_position[1]) * state.alpha;
+};
+
+// Zero runs the serial step on the calling thread. Anything else runs the
+// two-phase step on that many threads, the caller included; results are the
+// same for every count above zero.
+void physics_set_worker_count(u32 worker_count) {
+    if (state.job_pool != NULL) {
+        job_pool_destroy(state.job_pool);
+        state.job_pool = NULL;
+    };
+
+    state.worker_count = worker_count;
+
+    if (worker_count == 0) {
+        return;
+    };
+
+    state.job_pool = job_pool_create(worker_count);
+
+    if (state.job_pool == NULL) {
+        ERROR_EXIT("Could not create physics job pool\n");
+    };
+
+    while (state.jobs->len < worker_count * PHYSICS_JOBS_PER_WORKER) {
+        Physics_Job job;
+        physics_job_init(&job);
+
+        if (array_list_append(state.jobs, &job) == (usize)-1) {
+            ERROR_EXIT("Could not append physics job to list\n");
+        };
+    };
+};
+
+// Bodies within near_radius of a focus point step every step. Beyond it
+// they step every far_interval steps, and beyond far_radius they are frozen
+// until a focus point comes back; a far_radius of zero never freezes.
+// Sleeping bodies are unaffected.
+void physics_lod_set(f32 near_radius, f32 far_radius, u32 far_interval) {
+    state.lod_near_radius = near_radius;
+    state.lod_far_radius = far_radius;
+    state.lod_far_interval = far_interval > 0 ? far_interval : 1;
+};
+
+// Usually the player or the camera centre, set every frame before
+// physics_update. Up to PHYSICS_LOD_MAX_FOCUS points are used, and none
+// turns the tiers off.
+void physics_lod_set_focus(vec2 *points, u32 count) {
+    state.lod_focus_count = count < PHYSICS_LOD_MAX_FOCUS ? count : PHYSICS_LOD_MAX_FOCUS;
+
+    for (u32 i = 0; i < state.lod_focus_count; ++i) {
+        state.lod_focus[i][0] = points[i][0];
+        state.lod_focus[i][1] = points[i][1];
+    };
+};
+
+Physics_Stats physics_stats_get(void) {
+    return state.stats;
+};
+
+// Nearest static or active body the segment from `origin` to
+// `origin + magnitude` enters. Bodies are found through the grid as of the
+// last step. A ray starting inside a box hits it at time 0.
+bool physics_raycast(vec2 origin, vec2 magnitude, u8 collision_mask, Physics_Query_Hit *out) {
+    Body ray = {
+        .aabb = {.position = {origin[0], origin[1]}},
+        .collision_mask = collision_mask,
+    };
+
+    // Bodies are held where they are, as if dt were zero.
+    Sweep_Window window = {.span = 1};
+    Hit hit = sweep_static_bodies(&state.query_job, &ray, magnitude);
+    Hit hit_moving = sweep_bodies(&state.query_job, SLOT_MAP_NONE, &ray, magnitude, state.body_map->items->items, &window);
+    bool is_static = true;
+
+    // Terrain wins ties, so a body flush against a wall is not visible
+    // through it.
+    if (hit_moving.is_hit && (!hit.is_hit || hit_moving.time < hit.time)) {
+        hit = hit_moving;
+        hit.other_id = slot_map_handle_at(state.body_map, hit.other_id);
+        is_static = false;
+    }
+
+    state.query_job.stats = (Physics_Stats){0};
+
+    if (!hit.is_hit) {
+        return false;
+    }
+
+    if (out != NULL) {
+        f32 time = fmaxf(hit.time, 0);
+
+        *out = (Physics_Query_Hit){
+            .id = hit.other_id,
+            .is_static = is_static,
+            .time = time,
+            .position = {origin[0] + magnitude[0] * time, origin[1] + magnitude[1] * time},
+            .normal = {hit.normal[0], hit.normal[1]},
+        };
+    }
+
+    return true;
+};
+
+// Writes up to `capacity` static colliders, then active bodies, touching
+// the box into `out`, each in id order. Returns the number written.
+usize physics_overlap_aabb(AABB aabb, u8 collision_mask, Physics_Query_Hit *out, usize capacity) {
+    usize count = 0;
+    vec2 min, max;
+    aabb_min_max(min, max, aabb);
+
+    Array_List *candidates = state.query_job.candidates;
+    static_bodies_query(min, max, candidates);
+
+    u32 *ids = candidates->items;
+    for (usize i = 0; i < candidates->len && count < capacity; ++i) {
+        Static_Body *static_body = static_collider_at(ids[i]);
+
+        if ((static_body->collision_layer & collision_mask) != 0 && physics_aabb_intersect_aabb(aabb, static_body->aabb)) {
+            out[count++] = (Physics_Query_Hit){.id = ids[i], .is_static = true};
+        }
+    }
+
+    physics_grid_query_set(state.body_grids, collision_mask, min, max, candidates);
+
+    ids = candidates->items;
+    for (usize i = 0; i < candidates->len && count < capacity; ++i) {
+        Body *body = body_at(ids[i]);
+
+        if (body == NULL || !body->is_active || (body->collision_layer & collision_mask) == 0) {
+            continue;
+        }
+
+        if (physics_aabb_intersect_aabb(aabb, body->aabb)) {
+            out[count++] = (Physics_Query_Hit){.id = slot_map_handle_at(state.body_map, ids[i])};
+        }
+    }
+
+    return count;
+};
+
+usize physics_query_point(vec2 point, u8 collision_mask, Physics_Query_Hit *out, usize capacity) {
+    AABB aabb = {.position = {point[0], point[1]}};
+    return physics_overlap_aabb(aabb, collision_mask, out, capacity);
+};
+
+usize physics_body_create(vec2 position, vec2 size, vec2 velocity, f32 mass, u8 collision_layer, u8 collision_mask, bool is_kinematic, On_Hit on_hit, On_Hit_Static on_hit_static) {
+    Body body = {
+        .aabb = {
+            .position = {position[0], position[1]},
+            .half_size = {size[0] * 0.5, size[1] * 0.5},
+        },
+        .velocity = {velocity[0], velocity[1]},
+        .collision_layer = collision_layer,
+        .collision_mask = collision_mask,
+        .on_hit = on_hit,
+        .on_hit_static = on_hit_static,
+        .is_kinematic = is_kinematic,
+        .previous_position = {position[0], position[1]},
+        .contact_events = CONTACT_EVENT_ALL,
+        .is_active = true,
+        .mass = mass,
+    };
+
+    usize id = slot_map_insert(state.body_map, &body);
+
+    if (id == SLOT_MAP_INVALID) {
+        ERROR_EXIT("Could not append body to list\n");
+    }
+
+    body_grids_update(slot_map_index(id), &body, body.aabb);
+
+    return id;
+};
+
+// Returns NULL once the body has been removed, even if its slot was reused.
+Body *physics_body_get(usize id) {
+    return slot_map_get(state.body_map, id);
+};
+
+// Removal moves the last static body into the freed index, so the grid has
+// to follow it.
+static void grid_swap_remove(Spatial_Grid *grid, Array_List *list, usize index) {
+    usize last = list->len - 1;
+
+    physics_grid_remove(grid, index);
+    physics_grid_remove(grid, last);
+
+    if (index != last) {
+        physics_grid_update(grid, index, *(AABB *)array_list_get(list, last));
+    }
+}
+
+u8 physics_body_remove(usize id) {
+    if (physics_body_get(id) == NULL) {
+        ERROR_RETURN(1, "Body %zu not found\n", id);
+    };
+
+    // Free slots stay in the body array, and sweeps skip inactive entries.
+    physics_body_get(id)->is_active = false;
+    body_grids_remove(slot_map_index(id));
+    return slot_map_remove(state.body_map, id);
+};
+
+// Limits which Contact_Event phases reach the body's callbacks.
+void physics_body_set_contact_events(usize id, u8 contact_events) {
+    Body *body = physics_body_get(id);
+
+    if (body == NULL) {
+        ERROR_EXIT("Body %zu not found\n", id);
+    };
+
+    body->contact_events = contact_events;
+};
+
+void physics_body_wake(usize id) {
+    Body *body = physics_body_get(id);
+
+    if (body == NULL) {
+        ERROR_EXIT("Body %zu not found\n", id);
+    };
+
+    body_wake(body);
+};
+
+// Static ids switch to authored indices until the next compile.
+static void static_bodies_mark_dirty(void) {
+    state.static_tree.is_dirty = true;
+    state.static_revision = ++state.last_revision;
+    physics_pairs_drop_static(&state.pairs);
+}
+
+usize physics_static_body_create(vec2 position, vec2 size, u8 collision_layer) {
+    Static_Body static_body = {
+        .aabb = {
+            .position = {position[0], position[1]},
+            .half_size = {size[0] * 0.5, size[1] * 0.5},
+        },
+        .collision_layer = collision_layer,
+    };
+
+    if (array_list_append(state.static_body_list, &static_body) == -1) {
+        ERROR_EXIT("Could not apend static body to list\n");
+    };
+
+    usize id = state.static_body_list->len - 1;
+    physics_grid_update(&state.static_grid, id, static_body.aabb);
+    static_bodies_mark_dirty();
+
+    vec2 min, max;
+    aabb_min_max(min, max, static_body.aabb);
+    wake_region(min, max);
+
+    return id;
+};
+
+void physics_static_body_set_aabb(usize index, vec2 position, vec2 half_size) {
+    Static_Body *static_body = physics_static_body_get(index);
+
+    vec2 min, max;
+    aabb_min_max(min, max, static_body->aabb);
+    wake_region(min, max);
+
+    static_body->aabb.position[0] = position[0];
+    static_body->aabb.position[1] = position[1];
+    static_body->aabb.half_size[0] = half_size[0];
+    static_body->aabb.half_size[1] = half_size[1];
+
+    physics_grid_update(&state.static_grid, index, static_body->aabb);
+    static_bodies_mark_dirty();
+
+    aabb_min_max(min, max, static_body->aabb);
+    wake_region(min, max);
+};
+
+static void static_bodies_compile(void) {
+    physics_pairs_drop_static(&state.pairs);
+    physics_colliders_compile(&state.static_colliders, state.static_body_list, &state.static_grid);
+    physics_bvh_build(&state.static_tree, state.static_colliders.bodies);
+}
+
+// Merges the authored static bodies into colliders and builds the tree over
+// them. Called by the editor when an edit is finished and before saving.
+void physics_static_body_commit(void) {
+    if (state.static_tree.is_dirty) {
+        static_bodies_compile();
+    }
+};
+
+usize physics_static_collider_count(void) {
+    if (state.static_tree.is_dirty) {
+        return state.static_body_list->len;
+    }
+    return state.static_colliders.bodies->len;
+};
+
+Static_Body *physics_static_collider_get(usize id) {
+    return static_collider_at(id);
+};
+
+// Writes up to `capacity` authored static body indices the collider covers,
+// skipping the first `offset`, into `out` and returns the number written.
+// Calling again with the offset moved on by that number pages through the
+// rest; 0 means there are no more.
+usize physics_static_collider_sources(usize id, usize offset, u32 *out, usize capacity) {
+    if (state.static_tree.is_dirty) {
+        if (capacity == 0 || offset > 0) {
+            return 0;
+        }
+        out[0] = (u32)id;
+        return 1;
+    }
+
+    u32 first = *(u32 *)array_list_get(state.static_colliders.source_first, id);
+    u32 end = *(u32 *)array_list_get(state.static_colliders.source_first, id + 1);
+    u32 *sources = state.static_colliders.sources->items;
+    usize count = 0;
+
+    for (usize i = first + offset; i < end && count < capacity; ++i) {
+        out[count++] = sources[i];
+    }
+
+    return count;
+};
+
+
+Static_Body *physics_static_body_get(usize index) {
+    return array_list_get(state.static_body_list, index);
+};
+
+int physics_static_body_dump(const char* path) {
+    size_t total_size = sizeof(Array_List) + state.static_body_list->capacity * state.static_body_list->item_size;
+    void *buffer = malloc(total_size);
 
     // Copy the Array_List structure
     memcpy(buffer, state.static_body_list, sizeof(Array_List));
@@ -407,16 +1593,145 @@ void physics_static_body_load_from_bin(const char* path) {
     memcpy(list->items, (char *)file.data + sizeof(Array_List), list->capacity * list->item_size);
 
     state.static_body_list = list;
+    state.static_revision = ++state.last_revision;
+
+    physics_grid_clear(&state.static_grid);
+    for (usize i = 0; i < list->len; ++i) {
+        physics_grid_update(&state.static_grid, i, physics_static_body_get(i)->aabb);
+    }
+
+    static_bodies_compile();
+
+    // The whole level changed under any sleeping body.
+    for (u32 i = 0; i < slot_map_len(state.body_map); ++i) {
+        Body *body = body_at(i);
+
+        if (body != NULL) {
+            body_wake(body);
+        }
+    }
 
     // Free the file data if necessary
     // free(file.data);
 }
 
 u8 physics_static_body_remove(usize index) {
+    if (index >= state.static_body_list->len) {
+        ERROR_RETURN(1, "Index out of bounds\n");
+    };
+
+    vec2 min, max;
+    aabb_min_max(min, max, physics_static_body_get(index)->aabb);
+    wake_region(min, max);
+
+    grid_swap_remove(&state.static_grid, state.static_body_list, index);
+    static_bodies_mark_dirty();
     return array_list_remove(state.static_body_list, index);
 };
 
 
 usize physics_static_body_count(void) {
     return state.static_body_list->len;
-};
\ No newline at end of file
+};
+
+usize physics_trigger_create(vec2 position, vec2 size, u8 collision_mask, On_Trigger on_trigger) {
+    Trigger trigger = {
+        .aabb = {
+            .position = {position[0], position[1]},
+            .half_size = {size[0] * 0.5, size[1] * 0.5},
+        },
+        .collision_mask = collision_mask,
+        .contact_events = CONTACT_EVENT_ALL,
+        .is_active = true,
+        .on_trigger = on_trigger,
+    };
+
+    usize id = slot_map_insert(state.trigger_map, &trigger);
+
+    if (id == SLOT_MAP_INVALID) {
+        ERROR_EXIT("Could not append trigger to list\n");
+    };
+
+    physics_grid_update(&state.trigger_grid, slot_map_index(id), trigger.aabb);
+
+    return id;
+};
+
+// Returns NULL once the trigger has been removed.
+Trigger *physics_trigger_get(usize id) {
+    return slot_map_get(state.trigger_map, id);
+};
+
+// Bodies still inside do not get an end event.
+u8 physics_trigger_remove(usize id) {
+    if (physics_trigger_get(id) == NULL) {
+        ERROR_RETURN(1, "Trigger %zu not found\n", id);
+    };
+
+    physics_grid_remove(&state.trigger_grid, slot_map_index(id));
+    return slot_map_remove(state.trigger_map, id);
+};
+
+// Saves the world into the ring and returns the frame number to restore it
+// by. The last PHYSICS_SNAPSHOT_COUNT frames are kept. Call between
+// physics_update calls, never from a callback.
+u32 physics_snapshot_save(void) {
+    u32 frame = state.snapshot_frame++;
+    Physics_Snapshot *snapshot = &state.snapshots[frame % PHYSICS_SNAPSHOT_COUNT];
+
+    physics_snapshot_capture(snapshot, &state);
+    snapshot->frame = frame;
+    snapshot->is_used = true;
+
+    return frame;
+};
+
+// Puts the world back as it was when the frame was saved. Handles taken
+// since then go stale, and frames saved after it are dropped.
+u8 physics_snapshot_restore(u32 frame) {
+    Physics_Snapshot *snapshot = &state.snapshots[frame % PHYSICS_SNAPSHOT_COUNT];
+
+    if (!snapshot->is_used || snapshot->frame != frame) {
+        ERROR_RETURN(1, "Snapshot %u is no longer kept\n", frame);
+    };
+
+    if (physics_snapshot_apply(&state, snapshot)) {
+        physics_grid_clear(&state.static_grid);
+        for (usize i = 0; i < state.static_body_list->len; ++i) {
+            physics_grid_update(&state.static_grid, i, physics_static_body_get(i)->aabb);
+        }
+        static_bodies_compile();
+    };
+
+    // Grids are rebuilt at the start of the next step anyway; this keeps
+    // queries made before it correct.
+    for (u32 i = 0; i < slot_map_len(state.body_map); ++i) {
+        Body *body = body_at(i);
+
+        if (body == NULL || !body->is_active) {
+            body_grids_remove(i);
+        } else {
+            body_grids_update(i, body, body->aabb);
+        }
+    };
+    triggers_refresh();
+
+    // Until the next step counts them again.
+    state.sleeping_grids = PHYSICS_BODY_GRIDS_ALL;
+    state.sleeping_mask = 0xFF;
+
+    for (u32 i = 0; i < PHYSICS_SNAPSHOT_COUNT; ++i) {
+        if (state.snapshots[i].frame > frame) {
+            state.snapshots[i].is_used = false;
+        }
+    };
+    state.snapshot_frame = frame + 1;
+
+    return 0;
+};
+
+// Hash of every body's simulated state. Two runs fed the same input should
+// match frame for frame; the first frame that differs is where they split.
+u64 physics_checksum(void) {
+    return physics_snapshot_checksum(state.body_map);
+};
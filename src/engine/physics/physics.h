@@ -7,9 +7,11 @@
 typedef struct hit Hit;
 typedef struct body Body;
 typedef struct static_body Static_Body;
+typedef struct trigger Trigger;
 
 typedef void (*On_Hit)(Body *self, Body *other, Hit hit);
 typedef void (*On_Hit_Static)(Body *self, Static_Body *other, Hit hit);
+typedef void (*On_Trigger)(Trigger *self, Body *other, Hit hit);
 
 
 typedef enum collision_layer {
@@ -18,22 +20,53 @@ typedef enum collision_layer {
     COLLISION_LAYER_TERRAIN = 1 << 2,
 } Collision_Layer;
 
+// Phases of a contact, passed to callbacks in Hit.event. Each pair reports
+// at most one of them per step.
+typedef enum contact_event {
+    CONTACT_EVENT_BEGIN = 1,
+    CONTACT_EVENT_PERSIST = 1 << 1,
+    CONTACT_EVENT_END = 1 << 2,
+    CONTACT_EVENT_ALL = CONTACT_EVENT_BEGIN | CONTACT_EVENT_PERSIST | CONTACT_EVENT_END,
+} Contact_Event;
+
+// Distance tiers of physics_lod_set. Near bodies step every step, far ones
+// every far_interval steps with the skipped time added on, and frozen ones
+// not at all.
+typedef enum physics_lod {
+    PHYSICS_LOD_NEAR,
+    PHYSICS_LOD_FAR,
+    PHYSICS_LOD_FROZEN,
+} Physics_Lod;
+
 typedef struct aabb {
     vec2 position;
     vec2 half_size;
 } AABB;
 
+// Fields read every sub-step come first; the callbacks are only touched on
+// a hit.
 typedef struct body {
     AABB aabb;
     vec2 velocity;
     vec2 acceleration;
-    On_Hit on_hit;
-    On_Hit_Static on_hit_static;
+    // Position at the start of the last step, for render interpolation.
+    vec2 previous_position;
+    f32 mass;
     u8 collision_layer;
     u8 collision_mask;
-    f32 mass;
     bool is_kinematic;
     bool is_active;
+    // Sleeping bodies are skipped until something wakes them. Writing a
+    // non-zero velocity or moving the body wakes it on the next step.
+    bool is_sleeping;
+    u16 still_steps;
+    // Physics_Lod tier, and time passed since the body last stepped.
+    u8 lod;
+    f32 lod_dt;
+    On_Hit on_hit;
+    On_Hit_Static on_hit_static;
+    // Contact_Event flags the callbacks run for. All by default.
+    u8 contact_events;
 } Body;
 
 typedef struct static_body {
@@ -41,27 +74,91 @@ typedef struct static_body {
     u8 collision_layer;
 } Static_Body;
 
+// Overlap-only volume for pickups, hazards and checkpoints. Triggers never
+// move bodies and bodies never sweep against them; once per frame the
+// trigger hears about bodies on a layer in its mask that began, kept or
+// stopped overlapping it, with other_id holding the body handle. Fields may
+// be written directly and are picked up on the next step.
+typedef struct trigger {
+    AABB aabb;
+    u8 collision_mask;
+    // Contact_Event flags on_trigger runs for. All by default.
+    u8 contact_events;
+    bool is_active;
+    On_Trigger on_trigger;
+} Trigger;
+
+// Per-frame counters filled by physics_update.
+typedef struct physics_stats {
+    u32 candidate_pairs;
+    u32 hits;
+    // Sub-steps taken over all awake bodies.
+    u32 substeps;
+    // Active bodies simulated and skipped in the last step.
+    u32 awake_bodies;
+    u32 sleeping_bodies;
+    // Awake bodies the LOD tiers left out of the last step.
+    u32 held_bodies;
+} Physics_Stats;
+
+// Result of the scene queries. `id` is a body handle, or a static collider
+// id when is_static is set. Time, position and normal are only filled
+// by physics_raycast.
+typedef struct physics_query_hit {
+    usize id;
+    bool is_static;
+    f32 time;
+    vec2 position;
+    vec2 normal;
+} Physics_Query_Hit;
+
+// On an end event only other_id is set, and `other` in On_Hit is NULL if
+// that body has been removed.
 typedef struct hit {
     usize other_id;
     f32 time;
     vec2 position; 
     vec2 normal;
     bool is_hit;
+    u8 event;
 } Hit;
 
 void physics_init(void);
-void physics_update(void);
+void physics_update(f32 dt);
+void physics_set_fixed_timestep(f32 rate, u32 max_steps);
+void physics_set_worker_count(u32 worker_count);
+void physics_lod_set(f32 near_radius, f32 far_radius, u32 far_interval);
+void physics_lod_set_focus(vec2 *points, u32 count);
+f32 physics_alpha(void);
+void physics_body_interpolated_position(usize id, vec2 out);
 usize physics_body_create(vec2 position, vec2 size, vec2 velocity, f32 mass, u8 collision_layer, u8 collision_mask, bool is_kinematic, On_Hit on_hit, On_Hit_Static on_hit_static);
-Body *physics_body_get(usize index);
-u8 physics_body_remove(usize index);
+Body *physics_body_get(usize id);
+u8 physics_body_remove(usize id);
+void physics_body_wake(usize id);
+void physics_body_set_contact_events(usize id, u8 contact_events);
 Static_Body *physics_static_body_get(usize index);
 u8 physics_static_body_remove(usize index);
 usize physics_static_body_create(vec2 position, vec2 size, u8 collision_layer);
+void physics_static_body_set_aabb(usize index, vec2 position, vec2 half_size);
+void physics_static_body_commit(void);
+usize physics_static_collider_count(void);
+Static_Body *physics_static_collider_get(usize id);
+usize physics_static_collider_sources(usize id, usize offset, u32 *out, usize capacity);
 usize physics_static_body_count(void);
+usize physics_trigger_create(vec2 position, vec2 size, u8 collision_mask, On_Trigger on_trigger);
+Trigger *physics_trigger_get(usize id);
+u8 physics_trigger_remove(usize id);
 bool physics_point_intersect_aabb(vec2 point, AABB aabb);
 bool physics_aabb_intersect_aabb(AABB a, AABB b);
 int physics_static_body_dump(const char* path);
 void physics_static_body_load_from_bin(const char* path);
+Physics_Stats physics_stats_get(void);
+u32 physics_snapshot_save(void);
+u8 physics_snapshot_restore(u32 frame);
+u64 physics_checksum(void);
+bool physics_raycast(vec2 origin, vec2 magnitude, u8 collision_mask, Physics_Query_Hit *out);
+usize physics_overlap_aabb(AABB aabb, u8 collision_mask, Physics_Query_Hit *out, usize capacity);
+usize physics_query_point(vec2 point, u8 collision_mask, Physics_Query_Hit *out, usize capacity);
 
 AABB aabb_minkowski_difference(AABB a, AABB b);
 void aabb_penetration_vector(vec2 r, AABB aabb);
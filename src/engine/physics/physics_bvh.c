@@ -0,0 +1,296 @@
+#include <stdlib.h>
+#include <string.h>
+#include <linmath.h>
+
+#include "../util/util.h"
+#include "physics.h"
+#include "physics_internal.h"
+
+// qsort has no context argument; the build only runs on the main thread.
+static Array_List *sort_bodies;
+static u8 sort_axis;
+
+static int compare_centroid(const void *a, const void *b) {
+    Static_Body *x = array_list_get(sort_bodies, *(const u32 *)a);
+    Static_Body *y = array_list_get(sort_bodies, *(const u32 *)b);
+    f32 cx = x->aabb.position[sort_axis];
+    f32 cy = y->aabb.position[sort_axis];
+
+    if (cx != cy) {
+        return (cx > cy) - (cx < cy);
+    };
+    // Tie-break on index so builds are reproducible.
+    return (*(const u32 *)a > *(const u32 *)b) - (*(const u32 *)a < *(const u32 *)b);
+};
+
+static int compare_id(const void *a, const void *b) {
+    u32 x = *(const u32 *)a;
+    u32 y = *(const u32 *)b;
+    return (x > y) - (x < y);
+};
+
+// Node bounds are computed as (position - half_size) while the leaf test
+// uses position - (half_size + other_half_size). Pad them so rounding can
+// never make a node reject a ray its leaves would accept.
+static f32 pad(f32 value) {
+    return fabsf(value) * 1e-5f + 1e-4f;
+};
+
+static u32 build_node(Static_Tree *tree, Array_List *static_bodies, u32 first, u32 count) {
+    u32 node_index = tree->nodes->len;
+
+    if (array_list_append(tree->nodes, &(Bvh_Node){0}) == (usize)-1) {
+        ERROR_EXIT("Could not append bvh node to list\n");
+    };
+
+    u32 *indices = tree->build_indices->items;
+    Bvh_Node node = {
+        .min = {INFINITY, INFINITY},
+        .max = {-INFINITY, -INFINITY},
+    };
+    f32 centroid_min[2] = {INFINITY, INFINITY};
+    f32 centroid_max[2] = {-INFINITY, -INFINITY};
+
+    for (u32 i = first; i < first + count; ++i) {
+        Static_Body *static_body = array_list_get(static_bodies, indices[i]);
+        vec2 min, max;
+        aabb_min_max(min, max, static_body->aabb);
+
+        for (u8 axis = 0; axis < 2; ++axis) {
+            node.min[axis] = fminf(node.min[axis], min[axis]);
+            node.max[axis] = fmaxf(node.max[axis], max[axis]);
+            centroid_min[axis] = fminf(centroid_min[axis], static_body->aabb.position[axis]);
+            centroid_max[axis] = fmaxf(centroid_max[axis], static_body->aabb.position[axis]);
+        };
+        node.collision_layers |= static_body->collision_layer;
+    };
+
+    for (u8 axis = 0; axis < 2; ++axis) {
+        node.min[axis] -= pad(node.min[axis]);
+        node.max[axis] += pad(node.max[axis]);
+    };
+
+    if (count <= PHYSICS_BVH_LEAF_SIZE) {
+        node.first = first;
+        node.count = count;
+        *(Bvh_Node *)array_list_get(tree->nodes, node_index) = node;
+        return node_index;
+    };
+
+    // Median split along the axis with the widest spread of centroids.
+    sort_bodies = static_bodies;
+    sort_axis = (centroid_max[0] - centroid_min[0]) >= (centroid_max[1] - centroid_min[1]) ? 0 : 1;
+    qsort(indices + first, count, sizeof(u32), compare_centroid);
+
+    u32 half = count / 2;
+    build_node(tree, static_bodies, first, half);
+    node.first = build_node(tree, static_bodies, first + half, count - half);
+    node.count = 0;
+
+    *(Bvh_Node *)array_list_get(tree->nodes, node_index) = node;
+    return node_index;
+};
+
+void physics_bvh_init(Static_Tree *tree) {
+    tree->nodes = array_list_create(sizeof(Bvh_Node), 0);
+    tree->indices = array_list_create(sizeof(u32), 0);
+    tree->build_indices = array_list_create(sizeof(u32), 0);
+    tree->soa = (Static_Soa){0};
+    tree->is_dirty = false;
+};
+
+// Moves every leaf into its own block of PHYSICS_BVH_LEAF_SIZE lanes and
+// copies the static bodies it covers into the kernel's lane arrays.
+static void layout_leaves(Static_Tree *tree, Array_List *static_bodies) {
+    usize leaf_count = 0;
+    Bvh_Node *nodes = tree->nodes->items;
+
+    for (usize i = 0; i < tree->nodes->len; ++i) {
+        leaf_count += nodes[i].count > 0;
+    };
+
+    usize lane_count = leaf_count * PHYSICS_BVH_LEAF_SIZE;
+    physics_soa_reserve(&tree->soa, lane_count);
+
+    u32 padding = (u32)-1;
+    for (usize i = 0; i < lane_count; ++i) {
+        if (array_list_append(tree->indices, &padding) == (usize)-1) {
+            ERROR_EXIT("Could not append bvh index to list\n");
+        };
+    };
+
+    Static_Soa *soa = &tree->soa;
+    memset(soa->collision_layers, 0, lane_count * sizeof(u32));
+    memset(soa->position_x, 0, lane_count * sizeof(f32));
+    memset(soa->position_y, 0, lane_count * sizeof(f32));
+    memset(soa->half_size_x, 0, lane_count * sizeof(f32));
+    memset(soa->half_size_y, 0, lane_count * sizeof(f32));
+
+    u32 *build_indices = tree->build_indices->items;
+    u32 *indices = tree->indices->items;
+    u32 block = 0;
+
+    for (usize i = 0; i < tree->nodes->len; ++i) {
+        Bvh_Node *node = &nodes[i];
+
+        if (node->count == 0) {
+            continue;
+        };
+
+        for (u32 lane = 0; lane < node->count; ++lane) {
+            u32 index = build_indices[node->first + lane];
+            Static_Body *static_body = array_list_get(static_bodies, index);
+
+            indices[block + lane] = index;
+            soa->position_x[block + lane] = static_body->aabb.position[0];
+            soa->position_y[block + lane] = static_body->aabb.position[1];
+            soa->half_size_x[block + lane] = static_body->aabb.half_size[0];
+            soa->half_size_y[block + lane] = static_body->aabb.half_size[1];
+            soa->collision_layers[block + lane] = static_body->collision_layer;
+        };
+
+        node->first = block;
+        block += PHYSICS_BVH_LEAF_SIZE;
+    };
+};
+
+void physics_bvh_build(Static_Tree *tree, Array_List *static_bodies) {
+    tree->nodes->len = 0;
+    tree->indices->len = 0;
+    tree->build_indices->len = 0;
+    tree->is_dirty = false;
+
+    for (u32 i = 0; i < static_bodies->len; ++i) {
+        if (array_list_append(tree->build_indices, &i) == (usize)-1) {
+            ERROR_EXIT("Could not append bvh index to list\n");
+        };
+    };
+
+    if (static_bodies->len > 0) {
+        build_node(tree, static_bodies, 0, static_bodies->len);
+        layout_leaves(tree, static_bodies);
+    };
+};
+
+// Conservative version of ray_intersect_aabb against a node grown by the
+// moving body's half size. Entries later than `limit` are rejected.
+static bool node_ray_test(Bvh_Node *node, vec2 position, vec2 half_size, vec2 velocity, f32 limit) {
+    f32 last_entry = -INFINITY;
+    f32 first_exit = INFINITY;
+
+    for (u8 i = 0; i < 2; ++i) {
+        f32 min = node->min[i] - half_size[i];
+        f32 max = node->max[i] + half_size[i];
+
+        if (velocity[i] != 0) {
+            f32 t1 = (min - position[i]) / velocity[i];
+            f32 t2 = (max - position[i]) / velocity[i];
+
+            last_entry = fmaxf(last_entry, fminf(t1, t2));
+            first_exit = fminf(first_exit, fmaxf(t1, t2));
+        } else if (position[i] < min || position[i] > max) {
+            return false;
+        };
+    };
+
+    return first_exit >= last_entry && first_exit >= 0 && last_entry <= limit;
+};
+
+// Returns the number of static bodies handed to the sweep kernel. `visit`
+// is only called for the ones the kernel reports as hits. Only reads the
+// tree, so jobs may sweep it concurrently.
+u32 physics_bvh_sweep(Static_Tree *tree, Physics_Job *job, Body *body, vec2 velocity, Hit *result, Bvh_Visit visit) {
+    u32 tested = 0;
+
+    if (tree->nodes->len == 0) {
+        return tested;
+    };
+
+    Bvh_Node *nodes = tree->nodes->items;
+    u32 *indices = tree->indices->items;
+    u32 stack[PHYSICS_BVH_STACK_SIZE];
+    u32 stack_len = 0;
+
+    stack[stack_len++] = 0;
+
+    while (stack_len > 0) {
+        Bvh_Node *node = &nodes[stack[--stack_len]];
+
+        if ((node->collision_layers & body->collision_mask) == 0) {
+            continue;
+        };
+
+        // Hits tying with the current result still have to be visited for
+        // the tie-break, so only strictly later entries are pruned.
+        if (!node_ray_test(node, body->aabb.position, body->aabb.half_size, velocity, fminf(1, result->time))) {
+            continue;
+        };
+
+        if (node->count > 0) {
+            u32 hits = physics_sweep_kernel(
+                &tree->soa, node->first,
+                body->aabb.position, body->aabb.half_size, velocity,
+                body->collision_mask, fminf(1, result->time)
+            );
+            tested += node->count;
+
+            while (hits) {
+                u32 lane = 0;
+                while ((hits & (1u << lane)) == 0) {
+                    ++lane;
+                };
+                hits &= ~(1u << lane);
+                visit(job, result, body, indices[node->first + lane], velocity);
+            };
+        } else {
+            u32 left = (u32)(node - nodes) + 1;
+            if (stack_len + 2 > PHYSICS_BVH_STACK_SIZE) {
+                ERROR_EXIT("Static body tree too deep\n");
+            };
+            stack[stack_len++] = node->first;
+            stack[stack_len++] = left;
+        };
+    };
+
+    return tested;
+};
+
+void physics_bvh_query(Static_Tree *tree, vec2 min, vec2 max, Array_List *out) {
+    out->len = 0;
+
+    if (tree->nodes->len == 0) {
+        return;
+    };
+
+    Bvh_Node *nodes = tree->nodes->items;
+    u32 *indices = tree->indices->items;
+    u32 stack[PHYSICS_BVH_STACK_SIZE];
+    u32 stack_len = 0;
+
+    stack[stack_len++] = 0;
+
+    while (stack_len > 0) {
+        Bvh_Node *node = &nodes[stack[--stack_len]];
+
+        if (node->min[0] > max[0] || node->max[0] < min[0] ||
+            node->min[1] > max[1] || node->max[1] < min[1]) {
+            continue;
+        };
+
+        if (node->count > 0) {
+            for (u32 i = node->first; i < node->first + node->count; ++i) {
+                array_list_append(out, &indices[i]);
+            };
+        } else {
+            u32 left = (u32)(node - nodes) + 1;
+            if (stack_len + 2 > PHYSICS_BVH_STACK_SIZE) {
+                ERROR_EXIT("Static body tree too deep\n");
+            };
+            stack[stack_len++] = node->first;
+            stack[stack_len++] = left;
+        };
+    };
+
+    // Same id order as the grid so push-out is applied identically.
+    qsort(out->items, out->len, sizeof(u32), compare_id);
+};
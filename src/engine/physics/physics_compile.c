@@ -0,0 +1,322 @@
+#include <stdlib.h>
+#include <string.h>
+#include <linmath.h>
+
+#include "../util/util.h"
+#include "physics.h"
+#include "physics_internal.h"
+
+static u32 find_root(u32 *parents, u32 index) {
+    while (parents[index] != index) {
+        parents[index] = parents[parents[index]];
+        index = parents[index];
+    };
+    return index;
+};
+
+static int compare_f32(const void *a, const void *b) {
+    f32 x = *(const f32 *)a;
+    f32 y = *(const f32 *)b;
+    return (x > y) - (x < y);
+};
+
+// Sorts and removes duplicates in place, returning the new length.
+static u32 unique_edges(f32 *edges, u32 count) {
+    qsort(edges, count, sizeof(f32), compare_f32);
+
+    u32 unique = 0;
+    for (u32 i = 0; i < count; ++i) {
+        if (unique == 0 || edges[unique - 1] != edges[i]) {
+            edges[unique++] = edges[i];
+        };
+    };
+    return unique;
+};
+
+// Edges always come from the same set, so the search is exact.
+static u32 edge_index(f32 *edges, u32 count, f32 value) {
+    u32 low = 0;
+    u32 high = count;
+
+    while (low < high) {
+        u32 middle = (low + high) / 2;
+        if (edges[middle] < value) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        };
+    };
+    return low;
+};
+
+static bool has_area(AABB aabb) {
+    return aabb.half_size[0] > 0 && aabb.half_size[1] > 0;
+};
+
+// Sources are the authored bodies the collider was built from, so picking
+// and rendering can get back to the bodies the designer placed.
+static void collider_emit(Static_Colliders *colliders, Static_Body collider, u32 *sources, u32 source_count) {
+    if (array_list_append(colliders->bodies, &collider) == (usize)-1) {
+        ERROR_EXIT("Could not append static collider to list\n");
+    };
+
+    for (u32 i = 0; i < source_count; ++i) {
+        if (array_list_append(colliders->sources, &sources[i]) == (usize)-1) {
+            ERROR_EXIT("Could not append static collider source to list\n");
+        };
+    };
+
+    u32 end = colliders->sources->len;
+    if (array_list_append(colliders->source_first, &end) == (usize)-1) {
+        ERROR_EXIT("Could not append static collider source to list\n");
+    };
+};
+
+static void emit_unmerged(Static_Colliders *colliders, Array_List *static_bodies, u32 *members, u32 member_count) {
+    for (u32 i = 0; i < member_count; ++i) {
+        collider_emit(colliders, *(Static_Body *)array_list_get(static_bodies, members[i]), &members[i], 1);
+    };
+};
+
+// A merged collider's sources are the bodies on its layer sharing area with
+// it. Its area is covered by the component's bodies, so any such body
+// overlaps one of them and is in the component. The grid only returns
+// bodies near the collider, so this does not rescan the whole component.
+static void collider_emit_merged(Static_Colliders *colliders, Static_Body collider, Array_List *static_bodies, Spatial_Grid *grid, Array_List *candidates) {
+    vec2 min, max;
+    aabb_min_max(min, max, collider.aabb);
+    physics_grid_query(grid, min, max, candidates);
+
+    u32 *ids = candidates->items;
+    u32 source_count = 0;
+
+    for (usize i = 0; i < candidates->len; ++i) {
+        Static_Body *static_body = array_list_get(static_bodies, ids[i]);
+        vec2 body_min, body_max;
+        aabb_min_max(body_min, body_max, static_body->aabb);
+
+        if (static_body->collision_layer == collider.collision_layer &&
+            body_min[0] < max[0] && body_max[0] > min[0] && body_min[1] < max[1] && body_max[1] > min[1]) {
+            ids[source_count++] = ids[i];
+        };
+    };
+
+    collider_emit(colliders, collider, ids, source_count);
+};
+
+// Greedy meshing over the component's compressed edge grid: take the first
+// filled cell in row order, grow it right, then up while whole rows stay
+// filled. Cells are 0 empty, 1 filled, 2 taken.
+static void merge_component(Static_Colliders *colliders, Array_List *static_bodies, u32 *members, u32 member_count, Spatial_Grid *grid, Array_List *candidates) {
+    if (member_count == 1) {
+        emit_unmerged(colliders, static_bodies, members, member_count);
+        return;
+    };
+
+    f32 *xs = malloc(member_count * 2 * sizeof(f32));
+    f32 *ys = malloc(member_count * 2 * sizeof(f32));
+
+    if (!xs || !ys) {
+        ERROR_EXIT("Could not allocate memory for static body edges\n");
+    };
+
+    for (u32 i = 0; i < member_count; ++i) {
+        Static_Body *static_body = array_list_get(static_bodies, members[i]);
+        vec2 min, max;
+        aabb_min_max(min, max, static_body->aabb);
+
+        xs[i * 2] = min[0];
+        xs[i * 2 + 1] = max[0];
+        ys[i * 2] = min[1];
+        ys[i * 2 + 1] = max[1];
+    };
+
+    u32 x_count = unique_edges(xs, member_count * 2);
+    u32 y_count = unique_edges(ys, member_count * 2);
+    u64 cell_count = (u64)(x_count - 1) * (y_count - 1);
+
+    // Irregular layouts have few shared edges; leave them as authored
+    // rather than building a huge grid.
+    if (x_count < 2 || y_count < 2 || cell_count > PHYSICS_COMPILE_MAX_CELLS) {
+        emit_unmerged(colliders, static_bodies, members, member_count);
+        free(xs);
+        free(ys);
+        return;
+    };
+
+    u32 columns = x_count - 1;
+    u32 rows = y_count - 1;
+    u8 *cells = calloc(cell_count, 1);
+
+    if (!cells) {
+        ERROR_EXIT("Could not allocate memory for static body cells\n");
+    };
+
+    for (u32 i = 0; i < member_count; ++i) {
+        Static_Body *static_body = array_list_get(static_bodies, members[i]);
+
+        if (!has_area(static_body->aabb)) {
+            continue;
+        };
+
+        vec2 min, max;
+        aabb_min_max(min, max, static_body->aabb);
+
+        u32 x0 = edge_index(xs, x_count, min[0]);
+        u32 x1 = edge_index(xs, x_count, max[0]);
+        u32 y0 = edge_index(ys, y_count, min[1]);
+        u32 y1 = edge_index(ys, y_count, max[1]);
+
+        for (u32 y = y0; y < y1; ++y) {
+            memset(cells + (usize)y * columns + x0, 1, x1 - x0);
+        };
+    };
+
+    u8 collision_layer = ((Static_Body *)array_list_get(static_bodies, members[0]))->collision_layer;
+
+    for (u32 y = 0; y < rows; ++y) {
+        for (u32 x = 0; x < columns; ++x) {
+            if (cells[(usize)y * columns + x] != 1) {
+                continue;
+            };
+
+            u32 x_end = x + 1;
+            while (x_end < columns && cells[(usize)y * columns + x_end] == 1) {
+                ++x_end;
+            };
+
+            u32 y_end = y + 1;
+            while (y_end < rows) {
+                bool is_filled = true;
+                for (u32 i = x; i < x_end && is_filled; ++i) {
+                    is_filled = cells[(usize)y_end * columns + i] == 1;
+                };
+                if (!is_filled) {
+                    break;
+                };
+                ++y_end;
+            };
+
+            for (u32 j = y; j < y_end; ++j) {
+                memset(cells + (usize)j * columns + x, 2, x_end - x);
+            };
+
+            Static_Body collider = {
+                .aabb = {
+                    .position = {(xs[x] + xs[x_end]) * 0.5f, (ys[y] + ys[y_end]) * 0.5f},
+                    .half_size = {(xs[x_end] - xs[x]) * 0.5f, (ys[y_end] - ys[y]) * 0.5f},
+                },
+                .collision_layer = collision_layer,
+            };
+            collider_emit_merged(colliders, collider, static_bodies, grid, candidates);
+        };
+    };
+
+    // Zero-area bodies cover no cells but still collide, so keep them.
+    for (u32 i = 0; i < member_count; ++i) {
+        if (!has_area(((Static_Body *)array_list_get(static_bodies, members[i]))->aabb)) {
+            emit_unmerged(colliders, static_bodies, &members[i], 1);
+        };
+    };
+
+    free(cells);
+    free(xs);
+    free(ys);
+};
+
+void physics_colliders_init(Static_Colliders *colliders) {
+    colliders->bodies = array_list_create(sizeof(Static_Body), 0);
+    colliders->source_first = array_list_create(sizeof(u32), 0);
+    colliders->sources = array_list_create(sizeof(u32), 0);
+};
+
+// Merges touching or overlapping static bodies on the same collision layer
+// into as few rectangles as the greedy pass finds. Components come out in
+// order of their lowest body index, so the result only depends on the
+// bodies. `grid` must hold every static body.
+void physics_colliders_compile(Static_Colliders *colliders, Array_List *static_bodies, Spatial_Grid *grid) {
+    u32 count = static_bodies->len;
+    u32 zero = 0;
+
+    colliders->bodies->len = 0;
+    colliders->sources->len = 0;
+    colliders->source_first->len = 0;
+
+    if (array_list_append(colliders->source_first, &zero) == (usize)-1) {
+        ERROR_EXIT("Could not append static collider source to list\n");
+    };
+
+    if (count == 0) {
+        return;
+    };
+
+    u32 *parents = malloc(count * sizeof(u32));
+    u32 *component_first = calloc(count + 1, sizeof(u32));
+    u32 *members = malloc(count * sizeof(u32));
+    Array_List *candidates = array_list_create(sizeof(u32), 64);
+
+    if (!parents || !component_first || !members || !candidates) {
+        ERROR_EXIT("Could not allocate memory for static body compile\n");
+    };
+
+    for (u32 i = 0; i < count; ++i) {
+        parents[i] = i;
+    };
+
+    for (u32 i = 0; i < count; ++i) {
+        Static_Body *static_body = array_list_get(static_bodies, i);
+        vec2 min, max;
+        aabb_min_max(min, max, static_body->aabb);
+        physics_grid_query(grid, min, max, candidates);
+
+        u32 *ids = candidates->items;
+        for (usize j = 0; j < candidates->len; ++j) {
+            Static_Body *other = array_list_get(static_bodies, ids[j]);
+
+            if (ids[j] <= i || other->collision_layer != static_body->collision_layer) {
+                continue;
+            };
+
+            if (physics_aabb_intersect_aabb(static_body->aabb, other->aabb)) {
+                u32 a = find_root(parents, i);
+                u32 b = find_root(parents, ids[j]);
+                // Lowest index as root, so roots order components.
+                if (a < b) {
+                    parents[b] = a;
+                } else if (b < a) {
+                    parents[a] = b;
+                };
+            };
+        };
+    };
+
+    // Counting sort of bodies by root. Roots are each component's lowest
+    // index, so walking roots in index order visits components in order.
+    for (u32 i = 0; i < count; ++i) {
+        ++component_first[find_root(parents, i) + 1];
+    };
+    for (u32 i = 0; i < count; ++i) {
+        component_first[i + 1] += component_first[i];
+    };
+    for (u32 i = 0; i < count; ++i) {
+        u32 root = find_root(parents, i);
+        members[component_first[root]++] = i;
+    };
+
+    u32 first = 0;
+    for (u32 i = 0; i < count; ++i) {
+        if (find_root(parents, i) != i) {
+            continue;
+        };
+
+        u32 end = component_first[i];
+        merge_component(colliders, static_bodies, members + first, end - first, grid, candidates);
+        first = end;
+    };
+
+    free(parents);
+    free(component_first);
+    free(members);
+    free(candidates->items);
+    free(candidates);
+};
@@ -0,0 +1,214 @@
+#include <stdlib.h>
+#include <string.h>
+#include <linmath.h>
+
+#include "../util/util.h"
+#include "physics.h"
+#include "physics_internal.h"
+
+static u32 cell_hash(Spatial_Grid *grid, i32 x, i32 y) {
+    return (((u32)x * 73856093u) ^ ((u32)y * 19349663u)) & grid->bucket_mask;
+};
+
+static i32 cell_coordinate(Spatial_Grid *grid, f32 value) {
+    return (i32)floorf(value / grid->cell_size);
+};
+
+static void bucket_push(Grid_Bucket *bucket, u32 id) {
+    if (bucket->len == bucket->capacity) {
+        bucket->capacity = bucket->capacity > 0 ? bucket->capacity * 2 : 4;
+        u32 *ids = realloc(bucket->ids, bucket->capacity * sizeof(u32));
+        if (!ids) {
+            ERROR_EXIT("Could not allocate memory for grid bucket\n");
+        };
+        bucket->ids = ids;
+    };
+    bucket->ids[bucket->len++] = id;
+};
+
+static void bucket_erase(Grid_Bucket *bucket, u32 id) {
+    for (u32 i = 0; i < bucket->len; ++i) {
+        if (bucket->ids[i] == id) {
+            bucket->ids[i] = bucket->ids[--bucket->len];
+            return;
+        };
+    };
+};
+
+static Grid_Proxy *proxy_get(Spatial_Grid *grid, u32 id) {
+    while (grid->proxies->len <= id) {
+        if (array_list_append(grid->proxies, &(Grid_Proxy){0}) == (usize)-1) {
+            ERROR_EXIT("Could not append grid proxy to list\n");
+        };
+    };
+    return array_list_get(grid->proxies, id);
+};
+
+static void proxy_cells_apply(Spatial_Grid *grid, Grid_Proxy *proxy, u32 id, bool insert) {
+    if (proxy->is_oversized) {
+        u32 *ids = grid->oversized->items;
+        for (usize i = 0; i < grid->oversized->len; ++i) {
+            if (ids[i] == id) {
+                array_list_remove(grid->oversized, i);
+                break;
+            };
+        };
+        if (insert) {
+            array_list_append(grid->oversized, &id);
+        };
+        return;
+    };
+
+    for (i32 y = proxy->min_y; y <= proxy->max_y; ++y) {
+        for (i32 x = proxy->min_x; x <= proxy->max_x; ++x) {
+            Grid_Bucket *bucket = &grid->buckets[cell_hash(grid, x, y)];
+            if (insert) {
+                bucket_push(bucket, id);
+            } else {
+                bucket_erase(bucket, id);
+            };
+        };
+    };
+};
+
+void physics_grid_init(Spatial_Grid *grid, f32 cell_size, u32 bucket_count) {
+    // Bucket count must be a power of two for the hash mask.
+    grid->cell_size = cell_size;
+    grid->bucket_mask = bucket_count - 1;
+    grid->buckets = calloc(bucket_count, sizeof(Grid_Bucket));
+    grid->proxies = array_list_create(sizeof(Grid_Proxy), 0);
+    grid->oversized = array_list_create(sizeof(u32), 0);
+
+    if (!grid->buckets) {
+        ERROR_EXIT("Could not allocate memory for grid buckets\n");
+    };
+};
+
+void physics_grid_clear(Spatial_Grid *grid) {
+    for (u32 i = 0; i <= grid->bucket_mask; ++i) {
+        grid->buckets[i].len = 0;
+    };
+    grid->proxies->len = 0;
+    grid->oversized->len = 0;
+};
+
+void physics_grid_update(Spatial_Grid *grid, u32 id, AABB aabb) {
+    Grid_Proxy *proxy = proxy_get(grid, id);
+
+    vec2 min, max;
+    aabb_min_max(min, max, aabb);
+
+    Grid_Proxy next = {
+        .min_x = cell_coordinate(grid, min[0]),
+        .min_y = cell_coordinate(grid, min[1]),
+        .max_x = cell_coordinate(grid, max[0]),
+        .max_y = cell_coordinate(grid, max[1]),
+        .is_inserted = true,
+    };
+
+    if (proxy->is_inserted &&
+        proxy->min_x == next.min_x && proxy->min_y == next.min_y &&
+        proxy->max_x == next.max_x && proxy->max_y == next.max_y) {
+        return;
+    };
+
+    u64 cell_count = (u64)(next.max_x - next.min_x + 1) * (u64)(next.max_y - next.min_y + 1);
+    next.is_oversized = cell_count > grid->bucket_mask + 1;
+
+    if (proxy->is_inserted) {
+        proxy_cells_apply(grid, proxy, id, false);
+    };
+
+    *proxy = next;
+    proxy_cells_apply(grid, proxy, id, true);
+};
+
+void physics_grid_remove(Spatial_Grid *grid, u32 id) {
+    if (id >= grid->proxies->len) {
+        return;
+    };
+
+    Grid_Proxy *proxy = array_list_get(grid->proxies, id);
+
+    if (!proxy->is_inserted) {
+        return;
+    };
+
+    proxy_cells_apply(grid, proxy, id, false);
+    proxy->is_inserted = false;
+};
+
+static int compare_id(const void *a, const void *b) {
+    u32 x = *(const u32 *)a;
+    u32 y = *(const u32 *)b;
+    return (x > y) - (x < y);
+};
+
+static void grid_collect(Spatial_Grid *grid, vec2 min, vec2 max, Array_List *out) {
+    i32 min_x = cell_coordinate(grid, min[0]);
+    i32 min_y = cell_coordinate(grid, min[1]);
+    i32 max_x = cell_coordinate(grid, max[0]);
+    i32 max_y = cell_coordinate(grid, max[1]);
+
+    u64 cell_count = (u64)(max_x - min_x + 1) * (u64)(max_y - min_y + 1);
+
+    if (cell_count > grid->bucket_mask + 1) {
+        // Every bucket would be visited anyway.
+        for (u32 i = 0; i <= grid->bucket_mask; ++i) {
+            Grid_Bucket *bucket = &grid->buckets[i];
+            for (u32 j = 0; j < bucket->len; ++j) {
+                array_list_append(out, &bucket->ids[j]);
+            };
+        };
+    } else {
+        for (i32 y = min_y; y <= max_y; ++y) {
+            for (i32 x = min_x; x <= max_x; ++x) {
+                Grid_Bucket *bucket = &grid->buckets[cell_hash(grid, x, y)];
+                for (u32 j = 0; j < bucket->len; ++j) {
+                    array_list_append(out, &bucket->ids[j]);
+                };
+            };
+        };
+    };
+
+    u32 *oversized = grid->oversized->items;
+    for (usize i = 0; i < grid->oversized->len; ++i) {
+        array_list_append(out, &oversized[i]);
+    };
+};
+
+static void ids_sort_unique(Array_List *out) {
+    // Bodies spanning several cells, and cells sharing a bucket, produce
+    // duplicates. Sorting also keeps the narrow phase in id order so results
+    // match a linear scan.
+    u32 *ids = out->items;
+    qsort(ids, out->len, sizeof(u32), compare_id);
+
+    usize unique = 0;
+    for (usize i = 0; i < out->len; ++i) {
+        if (unique == 0 || ids[unique - 1] != ids[i]) {
+            ids[unique++] = ids[i];
+        };
+    };
+    out->len = unique;
+};
+
+void physics_grid_query(Spatial_Grid *grid, vec2 min, vec2 max, Array_List *out) {
+    out->len = 0;
+    grid_collect(grid, min, max, out);
+    ids_sort_unique(out);
+};
+
+// Queries the grids whose bit is set in grid_bits as if they were one, so
+// an id kept in several of them comes out once.
+void physics_grid_query_set(Spatial_Grid *grids, u32 grid_bits, vec2 min, vec2 max, Array_List *out) {
+    out->len = 0;
+
+    for (u32 i = 0; grid_bits != 0; ++i, grid_bits >>= 1) {
+        if (grid_bits & 1) {
+            grid_collect(&grids[i], min, max, out);
+        };
+    };
+
+    ids_sort_unique(out);
+};
@@ -1,11 +1,296 @@
 #pragma once
 
 #include "../util/util.h"
+#include "../util/slot_map.h"
+#include "../util/job.h"
 #include "../types.h"
+#include "physics.h"
+
+// A body falls asleep after staying below both thresholds for this many
+// steps. Velocity is per second, distance is per step.
+#define PHYSICS_SLEEP_STEPS 30
+#define PHYSICS_SLEEP_VELOCITY 1.f
+#define PHYSICS_SLEEP_DISTANCE 0.01f
+
+// A body moving further than this fraction of its half size in one step is
+// split into sub-steps, up to PHYSICS_MAX_SUBSTEPS. Slow bodies take one.
+#define PHYSICS_SUBSTEP_FRACTION 0.5f
+#define PHYSICS_MAX_SUBSTEPS 4
+
+// Bodies only drop to a farther LOD tier once they are this fraction past
+// its radius, so one walking along a boundary does not flip every step.
+#define PHYSICS_LOD_HYSTERESIS 0.1f
+#define PHYSICS_LOD_MAX_FOCUS 4
+
+#define PHYSICS_GRID_CELL_SIZE 64
+#define PHYSICS_GRID_BUCKET_COUNT 4096
+
+// Bodies are kept in one grid per collision layer bit, and bodies without a
+// layer in one more, so a sweep only visits the layers its mask names. Grid
+// bits use the layer bits as they are.
+#define PHYSICS_LAYER_COUNT 8
+#define PHYSICS_BODY_GRID_COUNT (PHYSICS_LAYER_COUNT + 1)
+#define PHYSICS_BODY_GRIDS_ALL ((1u << PHYSICS_BODY_GRID_COUNT) - 1)
+
+typedef struct grid_bucket {
+    u32 *ids;
+    u32 len;
+    u32 capacity;
+} Grid_Bucket;
+
+// Cell range an id currently occupies, so moves that stay inside the
+// same cells do not touch the buckets at all.
+typedef struct grid_proxy {
+    i32 min_x;
+    i32 min_y;
+    i32 max_x;
+    i32 max_y;
+    bool is_inserted;
+    bool is_oversized;
+} Grid_Proxy;
+
+// Spatial hash over fixed-size cells. Cells are hashed into a fixed number
+// of buckets, so a bucket may hold ids from several cells; queries return a
+// superset that the narrow phase filters.
+typedef struct spatial_grid {
+    f32 cell_size;
+    u32 bucket_mask;
+    Grid_Bucket *buckets;
+    Array_List *proxies;
+    // Ids covering more cells than there are buckets live here and are
+    // returned by every query.
+    Array_List *oversized;
+} Spatial_Grid;
+
+// A leaf is exactly one block of the sweep kernel, so its static bodies
+// are tested with one AVX2 or two SSE slab tests.
+#define PHYSICS_BVH_LEAF_SIZE 8
+#define PHYSICS_BVH_STACK_SIZE 64
+#define PHYSICS_SOA_ALIGNMENT 32
+
+// Flattened depth-first: an inner node's left child directly follows it and
+// `first` holds the right child. Leaves hold `count` entries of `indices`
+// starting at `first`, which is always a multiple of PHYSICS_BVH_LEAF_SIZE.
+typedef struct bvh_node {
+    f32 min[2];
+    f32 max[2];
+    u32 first;
+    u16 count;
+    u8 collision_layers;
+} Bvh_Node;
+
+// Static body fields laid out in leaf order, one aligned block of
+// PHYSICS_BVH_LEAF_SIZE lanes per leaf. Unused lanes have no collision layer.
+typedef struct static_soa {
+    void *memory;
+    usize capacity;
+    f32 *position_x;
+    f32 *position_y;
+    f32 *half_size_x;
+    f32 *half_size_y;
+    u32 *collision_layers;
+} Static_Soa;
+
+// Bounding volume hierarchy over the static colliders. Built in bulk and left
+// alone while the editor is changing bodies; is_dirty routes queries back to
+// the grid until the next build.
+typedef struct static_tree {
+    Array_List *nodes;
+    Array_List *indices;
+    Array_List *build_indices;
+    Static_Soa soa;
+    bool is_dirty;
+} Static_Tree;
+
+// Split each worker's share of bodies into a few jobs so one crowded range
+// does not hold up the whole step.
+#define PHYSICS_JOBS_PER_WORKER 4
+
+// A hit found while moving a body, replayed on the main thread once every
+// body has moved. Ids are the body's slot index and either the other body's
+// handle or the static body index.
+typedef struct physics_contact {
+    u32 index;
+    usize other_id;
+    Hit hit;
+    bool is_static;
+} Physics_Contact;
+
+// Scratch for one solver job. Every job owns its buffers, so jobs can run
+// on any thread, and contacts come out in body order whatever the worker
+// count.
+typedef struct physics_job {
+    u32 first;
+    u32 last;
+    Array_List *candidates;
+    Array_List *contacts;
+    Physics_Stats stats;
+} Physics_Job;
+
+// The part of the step a sub-step sweeps, from `start` to `start + span` as
+// fractions of dt. Bodies with a slot below moved_below have already moved
+// this step; the others are still where the step started.
+typedef struct sweep_window {
+    f32 dt;
+    f32 start;
+    f32 span;
+    u32 moved_below;
+} Sweep_Window;
+
+// A body's ongoing contact with another body or a static collider. `self`
+// and a dynamic `other` are body handles, so a reused slot is a new pair.
+typedef struct contact_pair {
+    usize self;
+    usize other;
+    u32 step;
+    bool is_static;
+    bool is_used;
+} Contact_Pair;
+
+// Open-addressed set of the pairs touching in the last step, used to turn
+// raw contacts into begin, persist and end events. `spare` is the same size
+// as `slots` and takes the survivors each step.
+typedef struct pair_cache {
+    Contact_Pair *slots;
+    Contact_Pair *spare;
+    u32 capacity;
+    u32 len;
+    u32 step;
+} Pair_Cache;
+
+// A trigger callback found during the frame, run once physics_update has
+// finished its steps.
+typedef struct trigger_event {
+    usize trigger;
+    usize body;
+    u8 event;
+} Trigger_Event;
+
+// Frames of history kept for rollback.
+#define PHYSICS_SNAPSHOT_COUNT 16
+
+// World state at the end of one frame. Buffers are kept between saves and
+// only grow, and static bodies are only copied when they changed since the
+// last save into this snapshot.
+typedef struct physics_snapshot {
+    Slot_Map *body_map;
+    Slot_Map *trigger_map;
+    Pair_Cache pairs;
+    Pair_Cache trigger_pairs;
+    Array_List *static_bodies;
+    u64 static_revision;
+    f32 accumulator;
+    u32 sleeping_count;
+    u32 lod_step;
+    u32 frame;
+    bool is_used;
+} Physics_Snapshot;
+
+// Largest compressed edge grid a component of touching static bodies may
+// need before it is left unmerged.
+#define PHYSICS_COMPILE_MAX_CELLS (1u << 22)
+
+// Static bodies merged per collision layer into as few rectangles as the
+// greedy pass finds. Collider i covers the authored bodies in `sources` from
+// source_first[i] up to source_first[i + 1].
+typedef struct static_colliders {
+    Array_List *bodies;
+    Array_List *source_first;
+    Array_List *sources;
+} Static_Colliders;
+
+typedef void (*Bvh_Visit)(Physics_Job *job, Hit *result, Body *body, usize other_id, vec2 velocity);
 
 typedef struct physics_state_internal {
     f32 gravity;
     f32 terminal_velocity;
-    Array_List *body_list;
+    // Fixed-timestep mode is on while fixed_step > 0.
+    f32 fixed_step;
+    u32 max_steps;
+    f32 accumulator;
+    f32 alpha;
+    Slot_Map *body_map;
     Array_List *static_body_list;
-} Physics_State_Internal;
\ No newline at end of file
+    // What sweeps collide with once committed. While the tree is dirty the
+    // authored bodies are used directly, one collider each.
+    Static_Colliders static_colliders;
+    // One grid per layer, and the grids each body slot is in as u16 bits.
+    Spatial_Grid body_grids[PHYSICS_BODY_GRID_COUNT];
+    Array_List *body_grid_bits;
+    Spatial_Grid static_grid;
+    Static_Tree static_tree;
+    // Scratch for everything that runs on the main thread. Scene queries
+    // get their own, since callbacks may run them while a step is iterating
+    // main_job's candidates.
+    Physics_Job main_job;
+    Physics_Job query_job;
+    // Two-phase mode is on while worker_count > 0. Bodies as they were at
+    // the start of the step, and the handle of every body moving in it.
+    u32 worker_count;
+    Job_Pool *job_pool;
+    Array_List *jobs;
+    Array_List *snapshot;
+    Array_List *step_handles;
+    // LOD tiers are only used while there is a focus point. lod_step
+    // staggers far bodies so a different share of them steps each time.
+    vec2 lod_focus[PHYSICS_LOD_MAX_FOCUS];
+    u32 lod_focus_count;
+    f32 lod_near_radius;
+    f32 lod_far_radius;
+    u32 lod_far_interval;
+    u32 lod_step;
+    // Upper bound on sleeping bodies, so waking by contact can be skipped
+    // when nothing is asleep.
+    u32 sleeping_count;
+    // Grids holding sleeping bodies and every mask among them, so waking
+    // by contact only looks where a sleeper could be touched.
+    u32 sleeping_grids;
+    u8 sleeping_mask;
+    // Contacts of bodies with callbacks. Both pair caches hand ended pairs
+    // over through ended_pairs.
+    Pair_Cache pairs;
+    Array_List *ended_pairs;
+    // Triggers have their own storage and grid, and pairs that advance once
+    // per frame rather than per step.
+    Slot_Map *trigger_map;
+    Spatial_Grid trigger_grid;
+    Pair_Cache trigger_pairs;
+    Array_List *trigger_events;
+    // Ring of saved frames. The static revision changes with every edit of
+    // the static bodies, and last_revision is the highest handed out.
+    Physics_Snapshot *snapshots;
+    u32 snapshot_frame;
+    u64 static_revision;
+    u64 last_revision;
+    Physics_Stats stats;
+} Physics_State_Internal;
+
+void physics_grid_init(Spatial_Grid *grid, f32 cell_size, u32 bucket_count);
+void physics_grid_clear(Spatial_Grid *grid);
+void physics_grid_update(Spatial_Grid *grid, u32 id, AABB aabb);
+void physics_grid_remove(Spatial_Grid *grid, u32 id);
+void physics_grid_query(Spatial_Grid *grid, vec2 min, vec2 max, Array_List *out);
+void physics_grid_query_set(Spatial_Grid *grids, u32 grid_bits, vec2 min, vec2 max, Array_List *out);
+
+void physics_bvh_init(Static_Tree *tree);
+void physics_bvh_build(Static_Tree *tree, Array_List *static_bodies);
+u32 physics_bvh_sweep(Static_Tree *tree, Physics_Job *job, Body *body, vec2 velocity, Hit *result, Bvh_Visit visit);
+void physics_bvh_query(Static_Tree *tree, vec2 min, vec2 max, Array_List *out);
+
+void physics_colliders_init(Static_Colliders *colliders);
+void physics_colliders_compile(Static_Colliders *colliders, Array_List *static_bodies, Spatial_Grid *grid);
+
+void physics_pairs_init(Pair_Cache *cache);
+u8 physics_pairs_touch(Pair_Cache *cache, usize self, usize other, bool is_static);
+void physics_pairs_advance(Pair_Cache *cache, Array_List *ended);
+void physics_pairs_drop_static(Pair_Cache *cache);
+void physics_pairs_copy(Pair_Cache *dst, Pair_Cache *src);
+void physics_pairs_keep(Pair_Cache *cache, Contact_Pair *pair);
+
+void physics_snapshot_init(Physics_Snapshot *snapshot);
+void physics_snapshot_capture(Physics_Snapshot *snapshot, Physics_State_Internal *state);
+bool physics_snapshot_apply(Physics_State_Internal *state, Physics_Snapshot *snapshot);
+u64 physics_snapshot_checksum(Slot_Map *body_map);
+
+void physics_soa_reserve(Static_Soa *soa, usize capacity);
+u32 physics_sweep_kernel(Static_Soa *soa, u32 first, vec2 position, vec2 half_size, vec2 velocity, u8 collision_mask, f32 limit);
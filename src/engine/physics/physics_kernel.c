@@ -0,0 +1,194 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <linmath.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PHYSICS_KERNEL_SSE2
+#endif
+
+#include "../util/util.h"
+#include "physics.h"
+#include "physics_internal.h"
+
+static void *align_pointer(void *pointer) {
+    uintptr_t address = (uintptr_t)pointer;
+    return (void *)((address + PHYSICS_SOA_ALIGNMENT - 1) & ~(uintptr_t)(PHYSICS_SOA_ALIGNMENT - 1));
+};
+
+void physics_soa_reserve(Static_Soa *soa, usize capacity) {
+    if (capacity <= soa->capacity) {
+        return;
+    };
+
+    // Five lane arrays carved out of one block, each starting on an
+    // alignment boundary. Capacity is always a multiple of the leaf size, so
+    // every array length is a multiple of the alignment.
+    usize lane_bytes = capacity * sizeof(f32);
+    void *memory = malloc(lane_bytes * 5 + PHYSICS_SOA_ALIGNMENT);
+
+    if (!memory) {
+        ERROR_EXIT("Could not allocate memory for static body lanes\n");
+    };
+
+    free(soa->memory);
+
+    u8 *base = align_pointer(memory);
+    soa->memory = memory;
+    soa->capacity = capacity;
+    soa->position_x = (f32 *)(base);
+    soa->position_y = (f32 *)(base + lane_bytes);
+    soa->half_size_x = (f32 *)(base + lane_bytes * 2);
+    soa->half_size_y = (f32 *)(base + lane_bytes * 3);
+    soa->collision_layers = (u32 *)(base + lane_bytes * 4);
+};
+
+#if defined(__AVX2__)
+
+static u32 sweep_kernel_avx2(Static_Soa *soa, u32 first, vec2 position, vec2 half_size, vec2 velocity, u8 collision_mask, f32 limit) {
+    __m256 last_entry = _mm256_set1_ps(-INFINITY);
+    __m256 first_exit = _mm256_set1_ps(INFINITY);
+    __m256 valid = _mm256_castsi256_ps(_mm256_cmpgt_epi32(
+        _mm256_and_si256(_mm256_load_si256((const __m256i *)(soa->collision_layers + first)), _mm256_set1_epi32(collision_mask)),
+        _mm256_setzero_si256()
+    ));
+
+    const f32 *centers[2] = {soa->position_x + first, soa->position_y + first};
+    const f32 *halves[2] = {soa->half_size_x + first, soa->half_size_y + first};
+
+    for (u8 axis = 0; axis < 2; ++axis) {
+        __m256 center = _mm256_load_ps(centers[axis]);
+        __m256 half = _mm256_add_ps(_mm256_load_ps(halves[axis]), _mm256_set1_ps(half_size[axis]));
+        __m256 min = _mm256_sub_ps(center, half);
+        __m256 max = _mm256_add_ps(center, half);
+        __m256 origin = _mm256_set1_ps(position[axis]);
+
+        if (velocity[axis] != 0) {
+            __m256 magnitude = _mm256_set1_ps(velocity[axis]);
+            __m256 t1 = _mm256_div_ps(_mm256_sub_ps(min, origin), magnitude);
+            __m256 t2 = _mm256_div_ps(_mm256_sub_ps(max, origin), magnitude);
+
+            last_entry = _mm256_max_ps(last_entry, _mm256_min_ps(t1, t2));
+            first_exit = _mm256_min_ps(first_exit, _mm256_max_ps(t1, t2));
+        } else {
+            valid = _mm256_and_ps(valid, _mm256_cmp_ps(origin, min, _CMP_GT_OQ));
+            valid = _mm256_and_ps(valid, _mm256_cmp_ps(origin, max, _CMP_LT_OQ));
+        };
+    };
+
+    valid = _mm256_and_ps(valid, _mm256_cmp_ps(first_exit, last_entry, _CMP_GT_OQ));
+    valid = _mm256_and_ps(valid, _mm256_cmp_ps(first_exit, _mm256_setzero_ps(), _CMP_GT_OQ));
+    valid = _mm256_and_ps(valid, _mm256_cmp_ps(last_entry, _mm256_set1_ps(1), _CMP_LT_OQ));
+    valid = _mm256_and_ps(valid, _mm256_cmp_ps(last_entry, _mm256_set1_ps(limit), _CMP_LE_OQ));
+
+    return (u32)_mm256_movemask_ps(valid);
+};
+
+#elif defined(PHYSICS_KERNEL_SSE2)
+
+static u32 sweep_kernel_sse2(Static_Soa *soa, u32 first, vec2 position, vec2 half_size, vec2 velocity, u8 collision_mask, f32 limit) {
+    u32 mask = 0;
+
+    for (u32 block = 0; block < PHYSICS_BVH_LEAF_SIZE; block += 4) {
+        u32 i = first + block;
+        __m128 last_entry = _mm_set1_ps(-INFINITY);
+        __m128 first_exit = _mm_set1_ps(INFINITY);
+        __m128 valid = _mm_castsi128_ps(_mm_cmpgt_epi32(
+            _mm_and_si128(_mm_load_si128((const __m128i *)(soa->collision_layers + i)), _mm_set1_epi32(collision_mask)),
+            _mm_setzero_si128()
+        ));
+
+        const f32 *centers[2] = {soa->position_x + i, soa->position_y + i};
+        const f32 *halves[2] = {soa->half_size_x + i, soa->half_size_y + i};
+
+        for (u8 axis = 0; axis < 2; ++axis) {
+            __m128 center = _mm_load_ps(centers[axis]);
+            __m128 half = _mm_add_ps(_mm_load_ps(halves[axis]), _mm_set1_ps(half_size[axis]));
+            __m128 min = _mm_sub_ps(center, half);
+            __m128 max = _mm_add_ps(center, half);
+            __m128 origin = _mm_set1_ps(position[axis]);
+
+            if (velocity[axis] != 0) {
+                __m128 magnitude = _mm_set1_ps(velocity[axis]);
+                __m128 t1 = _mm_div_ps(_mm_sub_ps(min, origin), magnitude);
+                __m128 t2 = _mm_div_ps(_mm_sub_ps(max, origin), magnitude);
+
+                last_entry = _mm_max_ps(last_entry, _mm_min_ps(t1, t2));
+                first_exit = _mm_min_ps(first_exit, _mm_max_ps(t1, t2));
+            } else {
+                valid = _mm_and_ps(valid, _mm_cmpgt_ps(origin, min));
+                valid = _mm_and_ps(valid, _mm_cmplt_ps(origin, max));
+            };
+        };
+
+        valid = _mm_and_ps(valid, _mm_cmpgt_ps(first_exit, last_entry));
+        valid = _mm_and_ps(valid, _mm_cmpgt_ps(first_exit, _mm_setzero_ps()));
+        valid = _mm_and_ps(valid, _mm_cmplt_ps(last_entry, _mm_set1_ps(1)));
+        valid = _mm_and_ps(valid, _mm_cmple_ps(last_entry, _mm_set1_ps(limit)));
+
+        mask |= (u32)_mm_movemask_ps(valid) << block;
+    };
+
+    return mask;
+};
+
+#else
+
+// Same slab test as ray_intersect_aabb, one lane at a time.
+static u32 sweep_kernel_scalar(Static_Soa *soa, u32 first, vec2 position, vec2 half_size, vec2 velocity, u8 collision_mask, f32 limit) {
+    u32 mask = 0;
+
+    for (u32 lane = 0; lane < PHYSICS_BVH_LEAF_SIZE; ++lane) {
+        u32 i = first + lane;
+
+        if ((soa->collision_layers[i] & collision_mask) == 0) {
+            continue;
+        };
+
+        f32 center[2] = {soa->position_x[i], soa->position_y[i]};
+        f32 half[2] = {soa->half_size_x[i] + half_size[0], soa->half_size_y[i] + half_size[1]};
+        f32 last_entry = -INFINITY;
+        f32 first_exit = INFINITY;
+        bool is_miss = false;
+
+        for (u8 axis = 0; axis < 2; ++axis) {
+            f32 min = center[axis] - half[axis];
+            f32 max = center[axis] + half[axis];
+
+            if (velocity[axis] != 0) {
+                f32 t1 = (min - position[axis]) / velocity[axis];
+                f32 t2 = (max - position[axis]) / velocity[axis];
+
+                last_entry = fmaxf(last_entry, fminf(t1, t2));
+                first_exit = fminf(first_exit, fmaxf(t1, t2));
+            } else if (position[axis] <= min || position[axis] >= max) {
+                is_miss = true;
+            };
+        };
+
+        if (!is_miss && first_exit > last_entry && first_exit > 0 && last_entry < 1 && last_entry <= limit) {
+            mask |= 1u << lane;
+        };
+    };
+
+    return mask;
+};
+
+#endif
+
+// Tests one moving box against the PHYSICS_BVH_LEAF_SIZE static bodies of
+// the block starting at `first`. Returns a bit per lane that
+// ray_intersect_aabb would report as a hit starting no later than `limit`;
+// the caller builds the Hit for those lanes.
+u32 physics_sweep_kernel(Static_Soa *soa, u32 first, vec2 position, vec2 half_size, vec2 velocity, u8 collision_mask, f32 limit) {
+#if defined(__AVX2__)
+    return sweep_kernel_avx2(soa, first, position, half_size, velocity, collision_mask, limit);
+#elif defined(PHYSICS_KERNEL_SSE2)
+    return sweep_kernel_sse2(soa, first, position, half_size, velocity, collision_mask, limit);
+#else
+    return sweep_kernel_scalar(soa, first, position, half_size, velocity, collision_mask, limit);
+#endif
+};
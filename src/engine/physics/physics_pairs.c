@@ -0,0 +1,176 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "../util/util.h"
+#include "physics.h"
+#include "physics_internal.h"
+
+#define PAIR_CACHE_MIN_CAPACITY 64
+
+static u32 pair_hash(Pair_Cache *cache, usize self, usize other, bool is_static) {
+    u64 hash = (u64)self * 0x9E3779B97F4A7C15ull ^ ((u64)other * 2 + is_static) * 0xC2B2AE3D27D4EB4Full;
+    return (u32)(hash ^ (hash >> 32)) & (cache->capacity - 1);
+};
+
+static Contact_Pair *pair_slot(Pair_Cache *cache, Contact_Pair *slots, usize self, usize other, bool is_static) {
+    u32 index = pair_hash(cache, self, other, is_static);
+
+    for (;;) {
+        Contact_Pair *pair = &slots[index];
+
+        if (!pair->is_used || (pair->self == self && pair->other == other && pair->is_static == is_static)) {
+            return pair;
+        };
+        index = (index + 1) & (cache->capacity - 1);
+    };
+};
+
+// Copies pairs into the spare table and swaps the two. Static pairs are left
+// out unless keep_static, and pairs that did not touch in this step unless
+// keep_stale; those go to `dropped` when it is given.
+static void pairs_rebuild(Pair_Cache *cache, bool keep_static, bool keep_stale, Array_List *dropped) {
+    Contact_Pair *slots = cache->slots;
+    Contact_Pair *spare = cache->spare;
+
+    memset(spare, 0, cache->capacity * sizeof(Contact_Pair));
+    cache->len = 0;
+
+    for (u32 i = 0; i < cache->capacity; ++i) {
+        Contact_Pair *pair = &slots[i];
+
+        if (!pair->is_used) {
+            continue;
+        };
+
+        if ((!keep_static && pair->is_static) || (!keep_stale && pair->step != cache->step)) {
+            if (dropped && array_list_append(dropped, pair) == (usize)-1) {
+                ERROR_EXIT("Could not append contact pair to list\n");
+            };
+            continue;
+        };
+
+        *pair_slot(cache, spare, pair->self, pair->other, pair->is_static) = *pair;
+        ++cache->len;
+    };
+
+    cache->slots = spare;
+    cache->spare = slots;
+};
+
+static void pairs_grow(Pair_Cache *cache) {
+    u32 capacity = cache->capacity > 0 ? cache->capacity * 2 : PAIR_CACHE_MIN_CAPACITY;
+    Contact_Pair *slots = calloc(capacity, sizeof(Contact_Pair));
+    Contact_Pair *spare = calloc(capacity, sizeof(Contact_Pair));
+
+    if (!slots || !spare) {
+        ERROR_EXIT("Could not allocate memory for contact pairs\n");
+    };
+
+    Contact_Pair *old = cache->slots;
+    u32 old_capacity = cache->capacity;
+
+    cache->slots = slots;
+    cache->capacity = capacity;
+
+    for (u32 i = 0; i < old_capacity; ++i) {
+        if (old[i].is_used) {
+            *pair_slot(cache, slots, old[i].self, old[i].other, old[i].is_static) = old[i];
+        };
+    };
+
+    free(old);
+    free(cache->spare);
+    cache->spare = spare;
+};
+
+void physics_pairs_init(Pair_Cache *cache) {
+    free(cache->slots);
+    free(cache->spare);
+    *cache = (Pair_Cache){.step = 1};
+};
+
+// Records that the pair touched in the current step. Returns the event the
+// contact stands for, or 0 when the pair already touched in this step.
+u8 physics_pairs_touch(Pair_Cache *cache, usize self, usize other, bool is_static) {
+    // Kept at most half full so probes stay short.
+    if ((cache->len + 1) * 2 > cache->capacity) {
+        pairs_grow(cache);
+    };
+
+    Contact_Pair *pair = pair_slot(cache, cache->slots, self, other, is_static);
+
+    if (!pair->is_used) {
+        *pair = (Contact_Pair){
+            .self = self,
+            .other = other,
+            .step = cache->step,
+            .is_static = is_static,
+            .is_used = true,
+        };
+        ++cache->len;
+        return CONTACT_EVENT_BEGIN;
+    };
+
+    if (pair->step == cache->step) {
+        return 0;
+    };
+
+    pair->step = cache->step;
+    return CONTACT_EVENT_PERSIST;
+};
+
+// Ends the step: pairs that did not touch in it are moved to `ended`.
+void physics_pairs_advance(Pair_Cache *cache, Array_List *ended) {
+    ended->len = 0;
+
+    if (cache->len > 0) {
+        pairs_rebuild(cache, true, false, ended);
+    };
+    ++cache->step;
+};
+
+// Puts back a pair physics_pairs_advance ended, as it was, for a body that
+// did not step and so could not touch it.
+void physics_pairs_keep(Pair_Cache *cache, Contact_Pair *pair) {
+    if ((cache->len + 1) * 2 > cache->capacity) {
+        pairs_grow(cache);
+    };
+
+    *pair_slot(cache, cache->slots, pair->self, pair->other, pair->is_static) = *pair;
+    ++cache->len;
+};
+
+// Makes dst an exact copy of src. The tables are only reallocated when the
+// capacities differ, since the hash depends on it.
+void physics_pairs_copy(Pair_Cache *dst, Pair_Cache *src) {
+    if (dst->capacity != src->capacity) {
+        free(dst->slots);
+        free(dst->spare);
+        dst->slots = NULL;
+        dst->spare = NULL;
+
+        if (src->capacity > 0) {
+            dst->slots = malloc(src->capacity * sizeof(Contact_Pair));
+            dst->spare = malloc(src->capacity * sizeof(Contact_Pair));
+
+            if (!dst->slots || !dst->spare) {
+                ERROR_EXIT("Could not allocate memory for contact pairs\n");
+            };
+        };
+        dst->capacity = src->capacity;
+    };
+
+    if (src->capacity > 0) {
+        memcpy(dst->slots, src->slots, src->capacity * sizeof(Contact_Pair));
+    };
+    dst->len = src->len;
+    dst->step = src->step;
+};
+
+// Static ids change meaning whenever the static bodies do, so their pairs
+// are forgotten without an end event.
+void physics_pairs_drop_static(Pair_Cache *cache) {
+    if (cache->len > 0) {
+        pairs_rebuild(cache, false, true, NULL);
+    };
+};
@@ -0,0 +1,110 @@
+#include <string.h>
+
+#include "../util/util.h"
+#include "../util/slot_map.h"
+#include "physics.h"
+#include "physics_internal.h"
+
+#define CHECKSUM_OFFSET 0xCBF29CE484222325ull
+#define CHECKSUM_PRIME 0x100000001B3ull
+
+void physics_snapshot_init(Physics_Snapshot *snapshot) {
+    *snapshot = (Physics_Snapshot){
+        .body_map = slot_map_create(sizeof(Body), 0),
+        .trigger_map = slot_map_create(sizeof(Trigger), 0),
+        .static_bodies = array_list_create(sizeof(Static_Body), 0),
+    };
+
+    if (!snapshot->body_map || !snapshot->trigger_map || !snapshot->static_bodies) {
+        ERROR_EXIT("Could not allocate memory for physics snapshot\n");
+    };
+};
+
+void physics_snapshot_capture(Physics_Snapshot *snapshot, Physics_State_Internal *state) {
+    if (slot_map_copy(snapshot->body_map, state->body_map) != 0 ||
+        slot_map_copy(snapshot->trigger_map, state->trigger_map) != 0) {
+        ERROR_EXIT("Could not save physics snapshot\n");
+    };
+
+    if (snapshot->static_revision != state->static_revision) {
+        if (array_list_copy(snapshot->static_bodies, state->static_body_list) != 0) {
+            ERROR_EXIT("Could not save physics snapshot\n");
+        };
+        snapshot->static_revision = state->static_revision;
+    };
+
+    physics_pairs_copy(&snapshot->pairs, &state->pairs);
+    physics_pairs_copy(&snapshot->trigger_pairs, &state->trigger_pairs);
+    snapshot->accumulator = state->accumulator;
+    snapshot->sleeping_count = state->sleeping_count;
+    snapshot->lod_step = state->lod_step;
+};
+
+// Returns whether the static bodies were copied back, in which case the
+// caller has to rebuild everything derived from them.
+bool physics_snapshot_apply(Physics_State_Internal *state, Physics_Snapshot *snapshot) {
+    if (slot_map_copy(state->body_map, snapshot->body_map) != 0 ||
+        slot_map_copy(state->trigger_map, snapshot->trigger_map) != 0) {
+        ERROR_EXIT("Could not restore physics snapshot\n");
+    };
+
+    physics_pairs_copy(&state->pairs, &snapshot->pairs);
+    physics_pairs_copy(&state->trigger_pairs, &snapshot->trigger_pairs);
+    state->accumulator = snapshot->accumulator;
+    state->sleeping_count = snapshot->sleeping_count;
+    state->lod_step = snapshot->lod_step;
+
+    if (state->static_revision == snapshot->static_revision) {
+        return false;
+    };
+
+    if (array_list_copy(state->static_body_list, snapshot->static_bodies) != 0) {
+        ERROR_EXIT("Could not restore physics snapshot\n");
+    };
+    state->static_revision = snapshot->static_revision;
+
+    return true;
+};
+
+static u64 checksum_add(u64 hash, u32 word) {
+    return (hash ^ word) * CHECKSUM_PRIME;
+};
+
+static u64 checksum_add_f32(u64 hash, f32 value) {
+    u32 word;
+    memcpy(&word, &value, sizeof(word));
+    return checksum_add(hash, word);
+};
+
+// FNV-1a over the simulated fields of every slot, in slot order. Callbacks
+// are left out, since their addresses differ between runs.
+u64 physics_snapshot_checksum(Slot_Map *body_map) {
+    u64 hash = CHECKSUM_OFFSET;
+    Slot *slots = body_map->slots->items;
+
+    for (u32 i = 0; i < slot_map_len(body_map); ++i) {
+        hash = checksum_add(hash, slots[i].generation);
+
+        Body *body = slot_map_at(body_map, i);
+
+        if (body == NULL) {
+            continue;
+        };
+
+        for (u8 j = 0; j < 2; ++j) {
+            hash = checksum_add_f32(hash, body->aabb.position[j]);
+            hash = checksum_add_f32(hash, body->aabb.half_size[j]);
+            hash = checksum_add_f32(hash, body->velocity[j]);
+            hash = checksum_add_f32(hash, body->acceleration[j]);
+            hash = checksum_add_f32(hash, body->previous_position[j]);
+        };
+
+        hash = checksum_add_f32(hash, body->mass);
+        hash = checksum_add(hash, body->collision_layer | body->collision_mask << 8 | body->contact_events << 16);
+        hash = checksum_add(hash, body->is_kinematic | body->is_active << 1 | body->is_sleeping << 2);
+        hash = checksum_add(hash, body->still_steps | body->lod << 16);
+        hash = checksum_add_f32(hash, body->lod_dt);
+    };
+
+    return hash;
+};
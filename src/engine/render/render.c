@@ -15,430 +15,418 @@ static f32 render_width = 1280 / 3;
 static f32 render_height = 720 / 3 ;
 static f32 scale = 3;
 
-static u32 vao_quad;
-static u32 vbo_quad;
-static u32 ebo_quad;
 static u32 vao_line;
-static u32 vbo_line;
-static u32 shader_default;
-static u32 shader_rounded;
-static u32 texture_color;
+static Shader shader_line;
+static u32 vao_rounded;
+static Shader shader_rounded;
 
 static u32 vao_batch;
-static u32 vbo_batch;
-static u32 ebo_batch;
-static u32 shader_batch;
-
-
-static Array_List *list_rounded_quad;
-static Array_List *list_standard_quad;
-static Array_List *list_quad_line;
-static Array_List *list_render_pipeline;
+static Shader shader_batch;
+static Vertex_Stream stream_batch;
+static Vertex_Stream stream_lines;
+static Vertex_Stream stream_rounded;
+static u32 vao_static;
+static Static_Sprites static_sprites;
+static Texture_Atlas atlas;
+// One white texel, so solid quads are sprites like any other.
+static Atlas_Region region_white;
+static Render_Stats stats;
+
+// Shaders as they appear in sort keys.
+typedef enum render_shader {
+    RENDER_SHADER_LINE,
+    RENDER_SHADER_BATCH,
+    RENDER_SHADER_ROUNDED,
+} Render_Shader;
+
+// Blend modes as they appear in sort keys. Everything alpha blends so far.
+typedef enum render_blend {
+    RENDER_BLEND_ALPHA,
+} Render_Blend;
+
+static const bool layer_is_sequential[RENDER_LAYER_COUNT] = {
+    [RENDER_LAYER_OVERLAY] = true,
+    [RENDER_LAYER_CURSOR] = true,
+};
 
-#define MAX_BATCHES 10
-static Batch batches[MAX_BATCHES];
-static usize batch_count = 0;
+// Queued draws, and their keys in the same order. The sort runs on the keys
+// and leaves the commands where they are.
+static Array_List *list_commands;
+static Array_List *list_sort_items;
+static Render_Sort_Item *sort_scratch;
+static u32 sort_scratch_capacity;
+
+// Sprites and line vertices are written in chunks per layer, so each
+// layer's items stay in a few ranges of their stream however the layers
+// interleave. A layer's chunks double in size through the frame up to the
+// maximum.
+#define RENDER_BATCH_CHUNK_SIZE 1024
+#define RENDER_BATCH_CHUNK_MAX_SIZE 8192
+
+// A layer's current chunk in one stream, and the command of the range it
+// is filling.
+typedef struct range_batch {
+    u8 *chunk;
+    u32 chunk_first;
+    u32 chunk_size;
+    u32 chunk_left;
+    u32 command;
+    bool has_command;
+} Range_Batch;
+
+static Range_Batch sprite_batches[RENDER_LAYER_COUNT];
+static Range_Batch line_batches[RENDER_LAYER_COUNT];
+static Range_Batch rounded_batches[RENDER_LAYER_COUNT];
+
+// Forgotten at the start of every frame's draws, since other code binds
+// things too.
+static Render_State gl_state;
 
 
 SDL_Window *render_init(void) {
     SDL_Window *window = render_init_window(window_width, window_height);
 
-    render_init_quad(&vao_quad, &vbo_quad, &ebo_quad);
-    render_init_line(&vao_line, &vbo_line);
-    render_init_batch_quads(&vao_batch, &vbo_batch, &ebo_batch);
-    render_init_shaders(&shader_default, &shader_batch, &shader_rounded, render_width, render_height);
-    render_init_color_texture(&texture_color);
+    render_init_lines(&vao_line, &stream_lines);
+    render_init_rounded_quads(&vao_rounded, &stream_rounded);
+    render_init_batch_sprites(&vao_batch, &stream_batch);
+    render_init_static_sprites(&vao_static, &static_sprites);
+    render_init_shaders(&shader_line, &shader_batch, &shader_rounded, render_width, render_height);
+    render_atlas_init(&atlas);
+    region_white = render_atlas_add(&atlas, (u8[]){255, 255, 255, 255}, 1, 1);
+
+    // Sample the texel's centre wherever the quad is
+    region_white.uvs[0] = region_white.uvs[2] = (region_white.uvs[0] + region_white.uvs[2]) * 0.5f;
+    region_white.uvs[1] = region_white.uvs[3] = (region_white.uvs[1] + region_white.uvs[3]) * 0.5f;
 
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    list_rounded_quad = array_list_create(sizeof(Rounded_Quad), 8);
-    list_standard_quad = array_list_create(sizeof(Standard_Quad), 8);
-    list_quad_line = array_list_create(sizeof(Quad_Line), 8);
+    list_commands = array_list_create(sizeof(Renderable), 64);
+    list_sort_items = array_list_create(sizeof(Render_Sort_Item), 64);
 
-    usize max_size = sizeof(Quad_Line);
+    stbi_set_flip_vertically_on_load(1);
+    
+    return window;
+};
 
-    if (sizeof(Standard_Quad) > max_size) {
-        max_size = sizeof(Standard_Quad);
-    }
-    if (sizeof(Rounded_Quad) > max_size) {
-        max_size = sizeof(Rounded_Quad);
-    }
-    if (sizeof(Batch_Vertex) > max_size) {
-        max_size = sizeof(Batch_Vertex);
+static u32 command_push(Render_Layer layer, Render_Shader shader, u32 texture, Renderable *renderable) {
+    u64 sequence = list_commands->len;
+    u64 state = ((u64)RENDER_BLEND_ALPHA << RENDER_KEY_BLEND_SHIFT)
+        | ((u64)shader << RENDER_KEY_SHADER_SHIFT)
+        | (texture & RENDER_KEY_TEXTURE_MASK);
+
+    u64 key = (u64)layer << RENDER_KEY_LAYER_SHIFT;
+    if (layer_is_sequential[layer]) {
+        key |= sequence << 24 | state;
+    } else {
+        key |= state << 32 | sequence;
     }
 
-    list_render_pipeline = array_list_create(max_size + sizeof(Renderable), 8);
+    array_list_append(list_sort_items, &(Render_Sort_Item){
+        .key = key,
+        .index = list_commands->len,
+    });
 
-    stbi_set_flip_vertically_on_load(1);
-    
-    return window;
+    return array_list_append(list_commands, renderable);
 };
 
+// Static sprites are queued first, so they draw under the rest of the world
+// layer. They are drawn as they stand when the frame ends.
 void render_begin(void) {
     glClearColor(0.08, 0.1, 0.1, 1);
     glClear(GL_COLOR_BUFFER_BIT);
 
-    list_rounded_quad->len = 0;
+    command_push(RENDER_LAYER_WORLD, RENDER_SHADER_BATCH, atlas.texture_id, &(Renderable){
+        .type = STATIC_BATCH,
+    });
 };
 
-static void render_rounded_quad(Rounded_Quad *rounded_quad) {
-    glUseProgram(shader_rounded);
-
-    mat4x4 model;
-    mat4x4_identity(model);
-
-    mat4x4_translate(model, rounded_quad->position[0], rounded_quad->position[1], 0);
-    mat4x4_scale_aniso(model, model, rounded_quad->size[0], rounded_quad->size[1], 1);
-
-    glUniformMatrix4fv(
-        glGetUniformLocation(shader_rounded, "model"), 1, GL_FALSE, &model[0][0]
-    );
-    glUniform4fv(glad_glGetUniformLocation(shader_rounded, "color"), 1, rounded_quad->color);
-
-    glUniform2f(glGetUniformLocation(shader_rounded, "resolution"), rounded_quad->size[0], rounded_quad->size[1]);
-    glUniform1f(glGetUniformLocation(shader_rounded, "border_radius"), rounded_quad->border_radius);
-    glUniform2f(glGetUniformLocation(shader_rounded, "center"), rounded_quad->position[0], rounded_quad->position[1]);
-
-    glBindVertexArray(vao_quad);
-
-    glBindTexture(GL_TEXTURE_2D, texture_color);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, NULL);
-
-    glBindVertexArray(0); 
+static void write_sprite(Sprite_Instance *sprite, vec2 position, vec2 size, vec4 uvs, u32 layer, vec4 color) {
+    sprite->position[0] = position[0];
+    sprite->position[1] = position[1];
+    sprite->size[0] = size[0];
+    sprite->size[1] = size[1];
+    sprite->layer = layer;
+
+    for (u32 i = 0; i < 4; ++i) {
+        f32 uv = uvs[i] < 0 ? 0 : uvs[i] > 1 ? 1 : uvs[i];
+        f32 channel = color[i] < 0 ? 0 : color[i] > 1 ? 1 : color[i];
+        sprite->uvs[i] = (u16)(uv * 65535.f + 0.5f);
+        sprite->color[i] = (u8)(channel * 255.f + 0.5f);
+    }
 };
 
-// static void render_batch(Batch_Vertex *vertices, usize count, u32 texture_id) {
-//     glBindBuffer(GL_ARRAY_BUFFER, vbo_batch);
-//     glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(Batch_Vertex), vertices);
-
-//     glActiveTexture(GL_TEXTURE0);
-//     glBindTexture(GL_TEXTURE_2D, texture_id);
-
-//     glUseProgram(shader_batch);
-//     glBindVertexArray(vao_batch);
+// Maps UVs within the region to UVs within its atlas layer.
+static void region_uvs(vec4 result, Atlas_Region *region, vec4 uvs) {
+    f32 width = region->uvs[2] - region->uvs[0];
+    f32 height = region->uvs[3] - region->uvs[1];
 
-//     glDrawElements(GL_TRIANGLES, (count >> 2) * 6, GL_UNSIGNED_INT, NULL);
-// };
+    result[0] = region->uvs[0] + uvs[0] * width;
+    result[1] = region->uvs[1] + uvs[1] * height;
+    result[2] = region->uvs[0] + uvs[2] * width;
+    result[3] = region->uvs[1] + uvs[3] * height;
+};
 
-static void append_quad(vec2 position, vec2 size, vec4 texture_coordinates, vec4 color, u32 texture_id, bool render_in_batch) {
-    if (render_in_batch) {
-        // Existing batch handling code
-        // Find or create a batch for the given texture_id
-        Batch *batch = NULL;
-        for (usize i = 0; i < batch_count; ++i) {
-            if (batches[i].texture_id == texture_id) {
-                batch = &batches[i];
-                break;
-            }
-        }
-        if (batch == NULL) {
-            // Create a new batch
-            if (batch_count >= MAX_BATCHES) {
-                ERROR_EXIT("Exceeded maximum number of batches.\n");
+// Reserves count items of the stream for the layer. They join the range
+// the layer is filling when they directly follow it and, on a sequential
+// layer, nothing else was queued in between.
+static void *range_push(Range_Batch *batch, Vertex_Stream *stream, Render_Layer layer, Renderable_Type type, Render_Shader shader, u32 texture, u32 count) {
+    if (batch->chunk_left < count) {
+        // Fill what is left with zeroed items, which draw nothing, so the
+        // range can run on into the next chunk when that directly follows
+        if (batch->has_command && batch->chunk_left > 0) {
+            Batch *range = &((Renderable *)array_list_get(list_commands, batch->command))->data.batch;
+            if (range->first + range->count == batch->chunk_first + batch->chunk_size - batch->chunk_left) {
+                memset(batch->chunk, 0, (usize)batch->chunk_left * stream->vertex_size);
+                range->count += batch->chunk_left;
             }
-            batch = &batches[batch_count++];
-            batch->texture_id = texture_id;
-            batch->vertices = array_list_create(sizeof(Batch_Vertex), 1024);  // Adjust initial capacity as needed
         }
 
-        // Append the quad to the batch's vertex list
-        vec4 uvs = {0, 0, 1, 1};
-        if (texture_coordinates != NULL) {
-            memcpy(uvs, texture_coordinates, sizeof(vec4));
+        if (batch->chunk_size == 0) {
+            batch->chunk_size = RENDER_BATCH_CHUNK_SIZE;
+        } else if (batch->chunk_size < RENDER_BATCH_CHUNK_MAX_SIZE) {
+            batch->chunk_size *= 2;
         }
+        batch->chunk = render_stream_reserve(stream, batch->chunk_size, &batch->chunk_first);
+        batch->chunk_left = batch->chunk_size;
+    }
 
-        Array_List *vertex_list = batch->vertices;
-
-        array_list_append(vertex_list, &(Batch_Vertex) {
-                .position = {position[0], position[1]},
-                .uvs = {uvs[0], uvs[1]},
-                .color = {color[0], color[1], color[2], color[3]},
-                .border_radius = 0,
-            });
-
-        array_list_append(vertex_list, &(Batch_Vertex) {
-                .position = {position[0] + size[0], position[1]},
-                .uvs = {uvs[2], uvs[1]},
-                .color = {color[0], color[1], color[2], color[3]},
-                .border_radius = 0,
-            });
-        array_list_append(vertex_list, &(Batch_Vertex) {
-                .position = {position[0] + size[0], position[1] + size[1]},
-                .uvs = {uvs[2], uvs[3]},
-                .color = {color[0], color[1], color[2], color[3]},
-                .border_radius = 0,
-            });
-        array_list_append(vertex_list, &(Batch_Vertex) {
-                .position = {position[0], position[1] + size[1]},
-                .uvs = {uvs[0], uvs[3]},
-                .color = {color[0], color[1], color[2], color[3]},
-                .border_radius = 0,
-            });
-
+    void *memory = batch->chunk;
+    u32 first = batch->chunk_first + batch->chunk_size - batch->chunk_left;
+    batch->chunk += (usize)count * stream->vertex_size;
+    batch->chunk_left -= count;
 
-    } else {
-        // Create a new batch for this quad and append it to the render pipeline
-        Batch new_batch;
-        new_batch.texture_id = texture_id;
-        new_batch.vertices = array_list_create(sizeof(Batch_Vertex), 4);
-
-        // Append the quad to the batch's vertex list
-        vec4 uvs = {0, 0, 1, 1};
-        if (texture_coordinates != NULL) {
-            memcpy(uvs, texture_coordinates, sizeof(vec4));
+    if (batch->has_command && (!layer_is_sequential[layer] || batch->command + 1 == list_commands->len)) {
+        Batch *range = &((Renderable *)array_list_get(list_commands, batch->command))->data.batch;
+        if (range->first + range->count == first) {
+            range->count += count;
+            return memory;
         }
-
-        Array_List *vertex_list = new_batch.vertices;
-
-        array_list_append(vertex_list, &(Batch_Vertex) {
-                .position = {position[0], position[1]},
-                .uvs = {uvs[0], uvs[1]},
-                .color = {color[0], color[1], color[2], color[3]},
-                .border_radius = 0,
-            });
-
-        array_list_append(vertex_list, &(Batch_Vertex) {
-                .position = {position[0] + size[0], position[1]},
-                .uvs = {uvs[2], uvs[1]},
-                .color = {color[0], color[1], color[2], color[3]},
-                .border_radius = 0,
-            });
-        array_list_append(vertex_list, &(Batch_Vertex) {
-                .position = {position[0] + size[0], position[1] + size[1]},
-                .uvs = {uvs[2], uvs[3]},
-                .color = {color[0], color[1], color[2], color[3]},
-                .border_radius = 0,
-            });
-        array_list_append(vertex_list, &(Batch_Vertex) {
-                .position = {position[0], position[1] + size[1]},
-                .uvs = {uvs[0], uvs[3]},
-                .color = {color[0], color[1], color[2], color[3]},
-                .border_radius = 0,
-            });
-
-        Renderable renderable = {
-            .type = BATCH,
-            .data.batch = new_batch,
-        };
-        array_list_append(list_render_pipeline, &renderable);
     }
-}
 
-static void render_batch(Batch *batch) {
-    glUseProgram(shader_batch);
-    glBindVertexArray(vao_batch);
+    batch->command = command_push(layer, shader, texture, &(Renderable){
+        .type = type,
+        .data.batch = {
+            .first = first,
+            .count = count,
+        },
+    });
+    batch->has_command = true;
 
-    Batch_Vertex *vertices = batch->vertices->items;
-    usize count = batch->vertices->len;
-    usize buffer_size = count * sizeof(Batch_Vertex);
+    return memory;
+};
 
-    glBindBuffer(GL_ARRAY_BUFFER, vbo_batch);
+static void sprite_push(Render_Layer layer, vec2 position, vec2 size, vec4 uvs, u32 atlas_layer, vec4 color) {
+    Sprite_Instance *sprite = range_push(&sprite_batches[layer], &stream_batch, layer, BATCH, RENDER_SHADER_BATCH, atlas.texture_id, 1);
+    write_sprite(sprite, position, size, uvs, atlas_layer, color);
+};
 
-    // Orphan the buffer
-    glBufferData(GL_ARRAY_BUFFER, buffer_size, NULL, GL_DYNAMIC_DRAW);
+Line_Vertex *render_lines_reserve(Render_Layer layer, u32 count) {
+    if (count > RENDER_BATCH_CHUNK_SIZE) {
+        ERROR_EXIT("Exceeded %u line vertices in one shape.\n", RENDER_BATCH_CHUNK_SIZE);
+    }
 
-    // Update the buffer data
-    glBufferSubData(GL_ARRAY_BUFFER, 0, buffer_size, vertices);
+    return range_push(&line_batches[layer], &stream_lines, layer, LINES, RENDER_SHADER_LINE, 0, count);
+};
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, batch->texture_id);
+// texture_coordinates are within the region, or the whole region if NULL.
+// Batched quads go on the world layer, the others on the overlay.
+static void append_quad(vec2 position, vec2 size, vec4 texture_coordinates, vec4 color, Atlas_Region *region, bool render_in_batch) {
+    vec4 uvs = {0, 0, 1, 1};
+    if (texture_coordinates != NULL) {
+        memcpy(uvs, texture_coordinates, sizeof(vec4));
+    }
 
-    glDrawElements(GL_TRIANGLES, (count / 4) * 6, GL_UNSIGNED_INT, NULL);
+    vec4 atlas_uvs;
+    region_uvs(atlas_uvs, region, uvs);
 
-    // Clear the batch for the next frame
-    batch->vertices->len = 0;
+    sprite_push(render_in_batch ? RENDER_LAYER_WORLD : RENDER_LAYER_OVERLAY, position, size, atlas_uvs, region->layer, color);
 }
 
-static void batch_render_vertices() {
-    glUseProgram(shader_batch);
-    glBindVertexArray(vao_batch);
+// Base instance draws need GL 4.2; before that the attributes are moved to
+// the range instead.
+static void render_batch(Batch *batch) {
+    render_state_use_shader(&gl_state, &shader_batch);
+    render_state_bind_vao(&gl_state, vao_batch);
+    render_state_bind_texture(&gl_state, GL_TEXTURE_2D_ARRAY, atlas.texture_id);
 
-    for (usize i = 0; i < batch_count; ++i) {
-        Batch *batch = &batches[i];
-        Batch_Vertex *vertices = batch->vertices->items;
-        usize count = batch->vertices->len;
+    if (GLAD_GL_VERSION_4_2) {
+        glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, 0, 4, batch->count, batch->first);
+    } else {
+        glBindBuffer(GL_ARRAY_BUFFER, stream_batch.vbo);
+        render_init_sprite_attributes(batch->first);
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, batch->count);
+    }
+
+    ++stats.draw_calls;
+    stats.quads += batch->count;
+}
 
-        glBindBuffer(GL_ARRAY_BUFFER, vbo_batch);
+static void render_static_batch(void) {
+    if (static_sprites.count == 0) {
+        return;
+    }
 
-        glBufferData(GL_ARRAY_BUFFER,  count * sizeof(Batch_Vertex), NULL, GL_DYNAMIC_DRAW);
+    render_state_use_shader(&gl_state, &shader_batch);
+    render_state_bind_vao(&gl_state, vao_static);
+    render_state_bind_texture(&gl_state, GL_TEXTURE_2D_ARRAY, atlas.texture_id);
 
-        glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(Batch_Vertex), vertices);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_sprites.count);
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, batch->texture_id);
+    ++stats.draw_calls;
+    stats.quads += static_sprites.count;
+}
 
-        glDrawElements(GL_TRIANGLES, (count >> 2) * 6, GL_UNSIGNED_INT, NULL);
+static void render_rounded_quads(Batch *batch) {
+    render_state_use_shader(&gl_state, &shader_rounded);
+    render_state_bind_vao(&gl_state, vao_rounded);
 
-        // Clear the batch for the next frame
-        batch->vertices->len = 0;
+    if (GLAD_GL_VERSION_4_2) {
+        glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, 0, 4, batch->count, batch->first);
+    } else {
+        glBindBuffer(GL_ARRAY_BUFFER, stream_rounded.vbo);
+        render_init_rounded_attributes(batch->first);
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, batch->count);
     }
-    
-    // Reset batch count for the next frame
-    batch_count = 0;
+
+    ++stats.draw_calls;
 }
 
-void append_quad_line(vec2 pos, vec2 size, vec4 color) {
-    array_list_append(list_render_pipeline, &(Renderable){
-        .type = QUAD_LINE,
-        .data.quad_line = {
-        .pos = {pos[0], pos[1]},
-        .size = {size[0], size[1]},
-        .color = {color[0], color[1], color[2], color[3]}
-    },
-    });
-};
+static void render_lines(Batch *batch) {
+    render_state_use_shader(&gl_state, &shader_line);
+    render_state_bind_vao(&gl_state, vao_line);
+    glLineWidth(3);
 
-void render_quad_line(Quad_Line *quad_line) {
-    vec2 points[4] = {
-        {quad_line->pos[0] - quad_line->size[0] * 0.5, quad_line->pos[1] - quad_line->size[1] * 0.5},
-        {quad_line->pos[0] + quad_line->size[0] * 0.5, quad_line->pos[1] - quad_line->size[1] * 0.5},
-        {quad_line->pos[0] + quad_line->size[0] * 0.5, quad_line->pos[1] + quad_line->size[1] * 0.5},
-        {quad_line->pos[0] - quad_line->size[0] * 0.5, quad_line->pos[1] + quad_line->size[1] * 0.5},
-    };
+    glDrawArrays(GL_LINES, batch->first, batch->count);
+    ++stats.draw_calls;
+}
 
-    render_line_segment(points[0], points[1], quad_line->color);
-    render_line_segment(points[1], points[2], quad_line->color);
-    render_line_segment(points[2], points[3], quad_line->color);
-    render_line_segment(points[3], points[0], quad_line->color);
+void append_quad_line(vec2 pos, vec2 size, vec4 color) {
+    render_lines_rect(RENDER_LAYER_OVERLAY, pos, size, color);
 };
 
-
 static void render_cursor() {
-    f32 mouseX_world = global.input.mouseX;
-    f32 mouseY_world = global.input.mouseY;
-    vec2 mousePos_world = {mouseX_world, mouseY_world};
-    Quad_Line quad_line = {
-        .pos = {mouseX_world, mouseY_world},
-        .size = {2,2},
-        .color = {BLUE[0], BLUE[1], BLUE[2], BLUE[3]},
-    };
-
-    render_quad_line(&quad_line);
+    vec2 position = {global.input.mouseX, global.input.mouseY};
+    render_lines_rect(RENDER_LAYER_CURSOR, position, (vec2){2, 2}, BLUE);
 }
 
-
 void append_standard_quad(f32 *aabb, vec4 color) {
-     
-    array_list_append(list_render_pipeline, &(Renderable){
-        .type = STANDARD_QUAD,
-        .data.standard_quad = {
-        .aabb = aabb,
-        .color = {color[0], color[1], color[2], color[3]}
-    },
-    });
-};
-
-void render_standard_quad_line(vec2 pos, vec2 size, vec4 color) {
-    vec2 points[4] = {
-        {pos[0] - size[0] * 0.5, pos[1] - size[1] * 0.5},
-        {pos[0] + size[0] * 0.5, pos[1] - size[1] * 0.5},
-        {pos[0] + size[0] * 0.5, pos[1] + size[1] * 0.5},
-        {pos[0] - size[0] * 0.5, pos[1] + size[1] * 0.5},
-    };
-
-    render_line_segment(points[0], points[1], color);
-    render_line_segment(points[1], points[2], color);
-    render_line_segment(points[2], points[3], color);
-    render_line_segment(points[3], points[0], color);
-};
-
-
-static void render_standard_quad(Standard_Quad *standard_quad) {
     vec2 size;
-    vec2_scale(size, &standard_quad->aabb[2], 2);
-    render_standard_quad_line(&standard_quad->aabb[0], size, standard_quad->color);
+    vec2_scale(size, &aabb[2], 2);
+    render_lines_rect(RENDER_LAYER_OVERLAY, &aabb[0], size, color);
 };
 
+// Sorts the queue, then draws it in key order. Ranges of the same stream
+// that end up next to each other and continue one another merge into one
+// draw.
 void render_end(SDL_Window *window) {
-    batch_render_vertices();
+    stats = (Render_Stats){0};
+    render_cursor();
 
-    for (usize i = 0; i < list_render_pipeline->len; ++i) {
+    u32 count = list_sort_items->len;
+    if (sort_scratch_capacity < count) {
+        sort_scratch_capacity = list_sort_items->capacity;
+        sort_scratch = realloc(sort_scratch, sort_scratch_capacity * sizeof(Render_Sort_Item));
+        if (!sort_scratch) {
+            ERROR_EXIT("Could not allocate memory for render queue\n");
+        }
+    }
+    Render_Sort_Item *sorted = render_queue_sort(list_sort_items->items, sort_scratch, count);
+    Renderable *commands = list_commands->items;
+
+    render_stream_submit(&stream_batch);
+    render_stream_submit(&stream_lines);
+    render_stream_submit(&stream_rounded);
+    render_static_upload(&static_sprites);
+
+    render_state_reset(&gl_state);
+    glActiveTexture(GL_TEXTURE0);
+    render_state_blend(&gl_state, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-        Renderable *renderable = array_list_get(list_render_pipeline, i);
+    for (u32 i = 0; i < count; ++i) {
+        Renderable *renderable = &commands[sorted[i].index];
 
         switch (renderable->type){
-        case ROUNDED_QUAD:
-            render_rounded_quad(&renderable->data.rounded_quad);
-            break;
-        case STANDARD_QUAD:
-            render_standard_quad(&renderable->data.standard_quad);
-            break;
-        case QUAD_LINE:
-            render_quad_line(&renderable->data.quad_line);
+        case STATIC_BATCH:
+            render_static_batch();
             break;
+        case ROUNDED_QUAD:
         case BATCH:
-            render_batch(&renderable->data.batch);
+        case LINES: {
+            Batch batch = renderable->data.batch;
+            while (i + 1 < count) {
+                Renderable *next = &commands[sorted[i + 1].index];
+                if (next->type != renderable->type || next->data.batch.first != batch.first + batch.count) {
+                    break;
+                }
+                batch.count += next->data.batch.count;
+                ++i;
+            }
+
+            if (renderable->type == BATCH) {
+                render_batch(&batch);
+            } else if (renderable->type == LINES) {
+                render_lines(&batch);
+            } else {
+                render_rounded_quads(&batch);
+            }
             break;
+        }
         default:
             break;
         }
     };
 
-    list_render_pipeline->len = 0;
+    stats.commands = count;
+    stats.state_changes = gl_state.issued;
+    stats.state_changes_skipped = gl_state.skipped;
+    list_commands->len = 0;
+    list_sort_items->len = 0;
+    for (u32 i = 0; i < RENDER_LAYER_COUNT; ++i) {
+        sprite_batches[i] = (Range_Batch){0};
+        line_batches[i] = (Range_Batch){0};
+        rounded_batches[i] = (Range_Batch){0};
+    }
+
+    render_stream_end_frame(&stream_batch);
+    render_stream_end_frame(&stream_lines);
+    render_stream_end_frame(&stream_rounded);
+    u64 upload_ticks = stream_batch.upload_ticks + stream_lines.upload_ticks + stream_rounded.upload_ticks;
+    stats.upload_ms = upload_ticks * 1000.0 / SDL_GetPerformanceFrequency();
+    stats.atlas_layers = atlas.layer_count;
+    stats.atlas_occupancy = render_atlas_occupancy(&atlas);
+    stream_batch.upload_ticks = 0;
+    stream_lines.upload_ticks = 0;
+    stream_rounded.upload_ticks = 0;
 
-    render_cursor();
     SDL_GL_SwapWindow(window);
 }
 
 void render_quad(vec2 pos, vec2 size, vec4 color) {
-    glUseProgram(shader_default);
-
-    mat4x4 model;
-    mat4x4_identity(model);
-
-    mat4x4_translate(model, pos[0], pos[1], 0);
-    mat4x4_scale_aniso(model, model, size[0], size[1], 1);
-
-    glUniformMatrix4fv(
-        glGetUniformLocation(shader_default, "model"), 1, GL_FALSE, &model[0][0]
-    );
-    glUniform4fv(glad_glGetUniformLocation(shader_default, "color"), 1, color);
-
-    glBindVertexArray(vao_quad);
-
-    glBindTexture(GL_TEXTURE_2D, texture_color);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, NULL);
-
-    glBindVertexArray(0); 
+    vec2 bottom_left = {pos[0] - size[0] * 0.5f, pos[1] - size[1] * 0.5f};
+    sprite_push(RENDER_LAYER_BACKGROUND, bottom_left, size, region_white.uvs, region_white.layer, color);
 };
 
+// UI quads share one stream range on their own layer, so the whole UI is
+// one draw however many there are. Within the range they draw in the order
+// they were appended.
 void append_rounded_quad(vec2 pos, vec2 size, vec4 color, u8 border_radius) {
-    // array_list_append(list_rounded_quad, &rounded_quad);
-    array_list_append(list_render_pipeline, &(Renderable){
-        .type = ROUNDED_QUAD,
-        .data.rounded_quad = {
-        .position = {pos[0], pos[1]},
-        .size = {size[0], size[1]},
-        .color = {color[0], color[1], color[2], color[3]},
-        .border_radius = border_radius
-    },
-    });
-}
-
-void render_line_segment(vec2 start, vec2 end, vec4 color) {
-    glUseProgram(shader_default);
-    glLineWidth(3);
-
-    f32 x = end[0] - start[0];
-    f32 y = end[1] - start[1];
-    f32 line[6] = {0, 0, 0, x, y, 0};
-
-    mat4x4 model;
-    mat4x4_translate(model, start[0], start[1], 0);
-
-    glUniformMatrix4fv(glGetUniformLocation(shader_default, "model"), 1, GL_FALSE, &model[0][0]);
-    glUniform4fv(glGetUniformLocation(shader_default, "color"), 1, color);
+    Rounded_Quad *quad = range_push(&rounded_batches[RENDER_LAYER_UI], &stream_rounded, RENDER_LAYER_UI, ROUNDED_QUAD, RENDER_SHADER_ROUNDED, 0, 1);
 
-    glBindTexture(GL_TEXTURE_2D, texture_color);
-    glBindVertexArray( vao_line);
+    quad->position[0] = pos[0];
+    quad->position[1] = pos[1];
+    quad->size[0] = size[0];
+    quad->size[1] = size[1];
+    quad->border_radius = border_radius;
 
-    glBindBuffer(GL_ARRAY_BUFFER, vbo_line);
-
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(line), line);
-    glDrawArrays(GL_LINES, 0, 2);
+    for (u32 i = 0; i < 4; ++i) {
+        f32 channel = color[i] < 0 ? 0 : color[i] > 1 ? 1 : color[i];
+        quad->color[i] = (u8)(channel * 255.f + 0.5f);
+    }
+}
 
-    glBindVertexArray(0);
+void render_line_segment(vec2 start, vec2 end, vec4 color) {
+    render_lines_segment(RENDER_LAYER_BACKGROUND, start, end, color);
 };
 
 
@@ -446,22 +434,17 @@ f32 render_get_scale() {
     return scale;
 };
 
-void render_sprite_sheet_init(Sprite_Sheet *sprite_sheet, const char *path, f32 cell_width, f32 cell_height) {
-     glGenTextures(1, &sprite_sheet->texture_id);
-     glActiveTexture(GL_TEXTURE0);
-     glBindTexture(GL_TEXTURE_2D, sprite_sheet->texture_id);
-
-     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+Render_Stats render_stats_get(void) {
+    return stats;
+};
 
+void render_sprite_sheet_init(Sprite_Sheet *sprite_sheet, const char *path, f32 cell_width, f32 cell_height) {
      int width, height, channel_count;
-     u8 *image_data = stbi_load(path, &width, &height, &channel_count, 0);
+     u8 *image_data = stbi_load(path, &width, &height, &channel_count, 4);
      if(!image_data) {
         ERROR_EXIT("Failed to load image: %s\n", path);
      };
-     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image_data); 
+     sprite_sheet->region = render_atlas_add(&atlas, image_data, width, height);
      stbi_image_free(image_data);
 
      sprite_sheet->width = (f32)width;
@@ -497,12 +480,38 @@ void render_sprite_sheet_frame(Sprite_Sheet *sprite_sheet, f32 row, f32 column,
         position[1] - size[1] * 0.5,
     };
     
-    append_quad(bottom_left, size, uvs, WHITE, sprite_sheet->texture_id, render_in_batch);
+    append_quad(bottom_left, size, uvs, WHITE, &sprite_sheet->region, render_in_batch);
     
 };
 
-void render_textured_quad_with_texture_id(vec2 position, vec2 size, vec4 uv_rect, vec4 color, u32 texture_id) {
-    append_quad(position, size, uv_rect, color, texture_id, true);
+void render_textured_quad(vec2 position, vec2 size, Atlas_Region *region, vec4 color) {
+    append_quad(position, size, NULL, color, region, true);
+}
+
+void render_static_sprites_resize(u32 count) {
+    render_static_resize(&static_sprites, count);
+}
+
+// Writes static sprite `index` as one frame of the sheet, like an
+// unflipped render_sprite_sheet_frame.
+void render_static_sprite_sheet_frame(u32 index, Sprite_Sheet *sprite_sheet, f32 row, f32 column, vec2 position) {
+    if (index >= static_sprites.count) {
+        ERROR_EXIT("Static sprite %u out of range.\n", index);
+    }
+
+    vec4 uvs;
+    calculate_sprite_texture_coordinate(uvs, row, column, sprite_sheet->width, sprite_sheet->height, sprite_sheet->cell_width, sprite_sheet->cell_height);
+
+    vec4 atlas_uvs;
+    region_uvs(atlas_uvs, &sprite_sheet->region, uvs);
+
+    vec2 size = {sprite_sheet->cell_width, sprite_sheet->cell_height};
+    vec2 bottom_left = {
+        position[0] - size[0] * 0.5f,
+        position[1] - size[1] * 0.5f,
+    };
+
+    write_sprite(render_static_write(&static_sprites, index), bottom_left, size, atlas_uvs, sprite_sheet->region.layer, WHITE);
 }
 
 void calculate_tile_uv(vec4 result, Sprite_Sheet *sprite_sheet, int row, int column) {
@@ -517,52 +526,13 @@ void calculate_tile_uv(vec4 result, Sprite_Sheet *sprite_sheet, int row, int col
     result[3] = v_max;
 }
 
-u32 create_tile_texture(Sprite_Sheet *sprite_sheet, const char *path, int row, int column) {
-    // Calculate the pixel coordinates of the tile in the tileset image
-    int x = column * sprite_sheet->cell_width;
-    int y = row * sprite_sheet->cell_height;
-    int width = sprite_sheet->cell_width;
-    int height = sprite_sheet->cell_height;
-
-    // Load the tileset image again
-    int img_width, img_height, img_channels;
-    u8 *image_data = stbi_load(path, &img_width, &img_height, &img_channels, 0);
-    if (!image_data) {
-        ERROR_EXIT("Failed to load image: %s\n", path);
-    }
-
-    // Create a buffer for the tile image data
-    int tile_channels = 4;  // We will use RGBA format
-    u8 *tile_data = malloc(width * height * tile_channels);
-
-    // Copy the pixel data for the selected tile
-    for (int i = 0; i < height; ++i) {
-        int src_row = y + i;
-        int dst_row = i;
-
-        memcpy(
-            tile_data + dst_row * width * tile_channels,
-            image_data + src_row * img_width * tile_channels + x * tile_channels,
-            width * tile_channels
-        );
-    }
-
-    stbi_image_free(image_data);
-
-    // Create a new texture for the tile
-    u32 texture_id;
-    glGenTextures(1, &texture_id);
-    glBindTexture(GL_TEXTURE_2D, texture_id);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);  // Repeat texture
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);  // Repeat texture
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);  // Important for pixel art
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-    // Upload the tile's pixel data to the texture
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, tile_data);
+// A single cell of the sheet, as its own region of the atlas.
+Atlas_Region render_sprite_sheet_region(Sprite_Sheet *sprite_sheet, int row, int column) {
+    vec4 uvs;
+    calculate_tile_uv(uvs, sprite_sheet, row, column);
 
-    free(tile_data);
+    Atlas_Region region = {.layer = sprite_sheet->region.layer};
+    region_uvs(region.uvs, &sprite_sheet->region, uvs);
 
-    return texture_id;
-}
\ No newline at end of file
+    return region;
+}
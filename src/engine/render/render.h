@@ -10,49 +10,65 @@
 #include "../util/util.h"
 
 
-typedef struct batch_vertex {
+// One sprite of the instanced batch. The vertex shader builds its corners
+// from gl_VertexID. UVs are normalized to u16, so they must lie in [0, 1].
+typedef struct sprite_instance {
     vec2 position;
-    vec2 uvs;
-    vec4 color;
-    u8 border_radius; 
-} Batch_Vertex;
-
+    vec2 size;
+    u16 uvs[4];
+    u8 color[4];
+    // Atlas layer the UVs are in.
+    u32 layer;
+} Sprite_Instance;
+
+// Where an image was packed in the sprite atlas.
+typedef struct atlas_region {
+    vec4 uvs;
+    u32 layer;
+} Atlas_Region;
+
+// One rounded rectangle of the instanced UI batch, by its centre. The
+// fragment shader cuts the corners from a signed distance to the outline.
 typedef struct rounded_quad {
     vec2 position;
     vec2 size;
-    vec4 color;
-    u8 border_radius; 
+    u8 color[4];
+    f32 border_radius;
 } Rounded_Quad;
 
-typedef struct standard_quad {
-    f32 *aabb;
-    vec4 color;
-} Standard_Quad;
-
-typedef struct quad_line {
-    vec2 pos;
-    vec2 size;
-    vec4 color;
-} Quad_Line;
-
 typedef enum renderable_type {
-    QUAD_LINE,
-    STANDARD_QUAD,
     ROUNDED_QUAD,
     BATCH,
+    LINES,
+    STATIC_BATCH,
 } Renderable_Type;
 
+// Draws are queued and sorted by layer first. render_quad and
+// render_line_segment go under the world, render_debug_* shapes over it,
+// the rounded UI quads over those, and the rest of the append_* overlay
+// and the cursor on top. Within the background, world, debug and UI layers
+// draws are grouped by state; the overlay and cursor keep submission order.
+typedef enum render_layer {
+    RENDER_LAYER_BACKGROUND,
+    RENDER_LAYER_WORLD,
+    RENDER_LAYER_DEBUG,
+    RENDER_LAYER_UI,
+    RENDER_LAYER_OVERLAY,
+    RENDER_LAYER_CURSOR,
+    RENDER_LAYER_COUNT,
+} Render_Layer;
+
+// Items already written to a stream, from `first` on: sprite instances for
+// BATCH, line vertices for LINES and rounded quad instances for
+// ROUNDED_QUAD.
 typedef struct {
-    Array_List *vertices;
-    u32 texture_id;
+    u32 first;
+    u32 count;
 } Batch;
 
 typedef struct renderable {
     Renderable_Type type;
     union {
-        Rounded_Quad rounded_quad;
-        Standard_Quad standard_quad;
-        Quad_Line quad_line;
         Batch batch;
     } data;
 } Renderable;
@@ -63,12 +79,22 @@ typedef struct sprite_sheet {
     f32 height;
     f32 cell_width;
     f32 cell_height;
-    u32 texture_id;
+    Atlas_Region region;
 } Sprite_Sheet;
 
-#define MAX_BATCH_QUADS 10000
-#define MAX_BATCH_VERTICES 40000
-#define MAX_BATCH_ELEMENTS 60000
+// Per-frame counters filled by render_end.
+typedef struct render_stats {
+    u32 quads;
+    u32 commands;
+    u32 draw_calls;
+    // Program, VAO, texture and blend changes issued, and those skipped
+    // because the state was already set.
+    u32 state_changes;
+    u32 state_changes_skipped;
+    f32 upload_ms;
+    u32 atlas_layers;
+    f32 atlas_occupancy;
+} Render_Stats;
 
 SDL_Window *render_init(void);
 void render_begin(void);
@@ -79,9 +105,17 @@ void append_quad_line(vec2 pos, vec2 size, vec4 color);
 void render_line_segment(vec2 start, vec2 end, vec4 color);
 void append_standard_quad(f32 *aabb, vec4 color);
 f32 render_get_scale();
+Render_Stats render_stats_get(void);
+void render_static_sprites_resize(u32 count);
+void render_static_sprite_sheet_frame(u32 index, Sprite_Sheet *sprite_sheet, f32 row, f32 column, vec2 position);
 
 void render_sprite_sheet_init(Sprite_Sheet *sprite_sheet, const char *path, f32 cell_width, f32 cell_height);
 void render_sprite_sheet_frame(Sprite_Sheet *sprite_sheet, f32 row, f32 column, vec2 position, bool is_flipped, bool render_in_batch);
-u32 create_tile_texture(Sprite_Sheet *sprite_sheet, const char *path, int row, int column);
-void render_textured_quad_with_texture_id(vec2 position, vec2 size, vec4 uv_rect, vec4 color, u32 texture_id);
-void calculate_tile_uv(vec4 result, Sprite_Sheet *sprite_sheet, int row, int column);
\ No newline at end of file
+Atlas_Region render_sprite_sheet_region(Sprite_Sheet *sprite_sheet, int row, int column);
+void render_textured_quad(vec2 position, vec2 size, Atlas_Region *region, vec4 color);
+void calculate_tile_uv(vec4 result, Sprite_Sheet *sprite_sheet, int row, int column);
+
+void render_debug_line(vec2 start, vec2 end, vec4 color);
+void render_debug_rect(vec2 position, vec2 size, vec4 color);
+void render_debug_aabb(f32 *aabb, vec4 color);
+void render_debug_circle(vec2 center, f32 radius, vec4 color);
\ No newline at end of file
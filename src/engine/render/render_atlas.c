@@ -0,0 +1,203 @@
+#include <glad/glad.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../util/util.h"
+#include "render_internal.h"
+
+// Empty texels kept around every image, so neighbours never bleed in.
+#define RENDER_ATLAS_PADDING 1
+
+void render_atlas_init(Texture_Atlas *atlas) {
+    *atlas = (Texture_Atlas){0};
+
+    glGenTextures(1, &atlas->texture_id);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, atlas->texture_id);
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+};
+
+// Lowest y at which a width-wide image can sit with its left edge on node
+// `index`, or false if it would leave the layer.
+static bool skyline_fit(Atlas_Layer *layer, u32 index, u32 width, u32 height, u32 *out_y) {
+    if (layer->nodes[index].x + width > RENDER_ATLAS_SIZE) {
+        return false;
+    };
+
+    u32 y = 0;
+    u32 width_left = width;
+
+    for (u32 i = index; width_left > 0; ++i) {
+        Skyline_Node *node = &layer->nodes[i];
+        if (node->y > y) {
+            y = node->y;
+        };
+        if (y + height > RENDER_ATLAS_SIZE) {
+            return false;
+        };
+        if (node->width >= width_left) {
+            break;
+        };
+        width_left -= node->width;
+    };
+
+    *out_y = y;
+    return true;
+};
+
+// Raises the skyline over the placed image, trimming the nodes it covers
+// and merging neighbours left at the same height.
+static void skyline_place(Atlas_Layer *layer, u32 index, u32 x, u32 y, u32 width, u32 height) {
+    Skyline_Node *nodes = layer->nodes;
+
+    memmove(&nodes[index + 1], &nodes[index], (layer->node_count - index) * sizeof(Skyline_Node));
+    nodes[index] = (Skyline_Node){x, y + height, width};
+    ++layer->node_count;
+
+    u32 right = x + width;
+    while (index + 1 < layer->node_count && nodes[index + 1].x < right) {
+        Skyline_Node *node = &nodes[index + 1];
+        u32 overlap = right - node->x;
+
+        if (node->width > overlap) {
+            node->x += overlap;
+            node->width -= overlap;
+            break;
+        };
+
+        memmove(node, node + 1, (layer->node_count - index - 2) * sizeof(Skyline_Node));
+        --layer->node_count;
+    };
+
+    for (u32 i = 0; i + 1 < layer->node_count;) {
+        if (nodes[i].y == nodes[i + 1].y) {
+            nodes[i].width += nodes[i + 1].width;
+            memmove(&nodes[i + 1], &nodes[i + 2], (layer->node_count - i - 2) * sizeof(Skyline_Node));
+            --layer->node_count;
+        } else {
+            ++i;
+        };
+    };
+};
+
+static void atlas_layer_add(Texture_Atlas *atlas) {
+    if (atlas->layer_count == RENDER_ATLAS_MAX_LAYERS) {
+        ERROR_EXIT("Exceeded maximum number of atlas layers.\n");
+    };
+
+    usize layer_size = RENDER_ATLAS_SIZE * RENDER_ATLAS_SIZE * 4;
+    u8 *pixels = realloc(atlas->pixels, layer_size * (atlas->layer_count + 1));
+    if (!pixels) {
+        ERROR_EXIT("Could not allocate memory for atlas layer\n");
+    };
+    memset(pixels + layer_size * atlas->layer_count, 0, layer_size);
+    atlas->pixels = pixels;
+
+    Atlas_Layer *layer = &atlas->layers[atlas->layer_count++];
+    layer->nodes = malloc(RENDER_ATLAS_SIZE * sizeof(Skyline_Node));
+    if (!layer->nodes) {
+        ERROR_EXIT("Could not allocate memory for atlas layer\n");
+    };
+    layer->nodes[0] = (Skyline_Node){0, 0, RENDER_ATLAS_SIZE};
+    layer->node_count = 1;
+
+    // Arrays cannot gain layers in place, so the whole texture is respecified
+    glBindTexture(GL_TEXTURE_2D_ARRAY, atlas->texture_id);
+    glTexImage3D(
+        GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, RENDER_ATLAS_SIZE, RENDER_ATLAS_SIZE, atlas->layer_count,
+        0, GL_RGBA, GL_UNSIGNED_BYTE, atlas->pixels
+    );
+};
+
+// Packs an RGBA8 image into the first layer with room for it, adding a
+// layer if none has, and returns where it went.
+Atlas_Region render_atlas_add(Texture_Atlas *atlas, u8 *pixels, u32 width, u32 height) {
+    u32 packed_width = width + RENDER_ATLAS_PADDING * 2;
+    u32 packed_height = height + RENDER_ATLAS_PADDING * 2;
+
+    if (packed_width > RENDER_ATLAS_SIZE || packed_height > RENDER_ATLAS_SIZE) {
+        ERROR_EXIT("Image of %ux%u does not fit in the atlas.\n", width, height);
+    };
+
+    u32 layer_index = 0;
+    u32 best_index = 0;
+    u32 best_x = 0;
+    u32 best_y = 0;
+    bool is_found = false;
+
+    for (; layer_index < atlas->layer_count; ++layer_index) {
+        Atlas_Layer *layer = &atlas->layers[layer_index];
+        u32 best_top = UINT32_MAX;
+        u32 best_width = UINT32_MAX;
+
+        for (u32 i = 0; i < layer->node_count; ++i) {
+            u32 y;
+            if (!skyline_fit(layer, i, packed_width, packed_height, &y)) {
+                continue;
+            };
+
+            u32 top = y + packed_height;
+            if (top < best_top || (top == best_top && layer->nodes[i].width < best_width)) {
+                best_top = top;
+                best_width = layer->nodes[i].width;
+                best_index = i;
+                best_x = layer->nodes[i].x;
+                best_y = y;
+                is_found = true;
+            };
+        };
+
+        if (is_found) {
+            break;
+        };
+    };
+
+    if (!is_found) {
+        atlas_layer_add(atlas);
+        layer_index = atlas->layer_count - 1;
+        best_index = 0;
+        best_x = 0;
+        best_y = 0;
+    };
+
+    skyline_place(&atlas->layers[layer_index], best_index, best_x, best_y, packed_width, packed_height);
+
+    u32 x = best_x + RENDER_ATLAS_PADDING;
+    u32 y = best_y + RENDER_ATLAS_PADDING;
+    u8 *layer_pixels = atlas->pixels + (usize)RENDER_ATLAS_SIZE * RENDER_ATLAS_SIZE * 4 * layer_index;
+
+    for (u32 row = 0; row < height; ++row) {
+        memcpy(
+            layer_pixels + ((usize)(y + row) * RENDER_ATLAS_SIZE + x) * 4,
+            pixels + (usize)row * width * 4,
+            width * 4
+        );
+    };
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, atlas->texture_id);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, x, y, layer_index, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+    atlas->used_area += (u64)width * height;
+
+    return (Atlas_Region){
+        .uvs = {
+            (f32)x / RENDER_ATLAS_SIZE,
+            (f32)y / RENDER_ATLAS_SIZE,
+            (f32)(x + width) / RENDER_ATLAS_SIZE,
+            (f32)(y + height) / RENDER_ATLAS_SIZE,
+        },
+        .layer = layer_index,
+    };
+};
+
+// Share of the allocated layers covered by images.
+f32 render_atlas_occupancy(Texture_Atlas *atlas) {
+    if (atlas->layer_count == 0) {
+        return 0;
+    };
+
+    return (f32)atlas->used_area / ((f32)RENDER_ATLAS_SIZE * RENDER_ATLAS_SIZE * atlas->layer_count);
+};
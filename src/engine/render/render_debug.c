@@ -0,0 +1,81 @@
+#include <math.h>
+
+#include "../util/util.h"
+#include "render.h"
+#include "render_internal.h"
+
+#define RENDER_DEBUG_CIRCLE_SEGMENTS 24
+#define RENDER_DEBUG_TAU 6.28318531f
+
+static void line_vertex(Line_Vertex *vertex, f32 x, f32 y, vec4 color) {
+    vertex->position[0] = x;
+    vertex->position[1] = y;
+
+    for (u32 i = 0; i < 4; ++i) {
+        f32 channel = color[i] < 0 ? 0 : color[i] > 1 ? 1 : color[i];
+        vertex->color[i] = (u8)(channel * 255.f + 0.5f);
+    };
+};
+
+void render_lines_segment(Render_Layer layer, vec2 start, vec2 end, vec4 color) {
+    Line_Vertex *vertices = render_lines_reserve(layer, 2);
+
+    line_vertex(&vertices[0], start[0], start[1], color);
+    line_vertex(&vertices[1], end[0], end[1], color);
+};
+
+// Outline of the rectangle centred on position.
+void render_lines_rect(Render_Layer layer, vec2 position, vec2 size, vec4 color) {
+    Line_Vertex *vertices = render_lines_reserve(layer, 8);
+
+    f32 min_x = position[0] - size[0] * 0.5f;
+    f32 min_y = position[1] - size[1] * 0.5f;
+    f32 max_x = position[0] + size[0] * 0.5f;
+    f32 max_y = position[1] + size[1] * 0.5f;
+
+    line_vertex(&vertices[0], min_x, min_y, color);
+    line_vertex(&vertices[1], max_x, min_y, color);
+    line_vertex(&vertices[2], max_x, min_y, color);
+    line_vertex(&vertices[3], max_x, max_y, color);
+    line_vertex(&vertices[4], max_x, max_y, color);
+    line_vertex(&vertices[5], min_x, max_y, color);
+    line_vertex(&vertices[6], min_x, max_y, color);
+    line_vertex(&vertices[7], min_x, min_y, color);
+};
+
+// Debug shapes are drawn over the world and under the overlay, all of
+// them with as few draws as their layer's ranges allow, usually one.
+
+void render_debug_line(vec2 start, vec2 end, vec4 color) {
+    render_lines_segment(RENDER_LAYER_DEBUG, start, end, color);
+};
+
+void render_debug_rect(vec2 position, vec2 size, vec4 color) {
+    render_lines_rect(RENDER_LAYER_DEBUG, position, size, color);
+};
+
+// Takes an AABB laid out as position then half size.
+void render_debug_aabb(f32 *aabb, vec4 color) {
+    vec2 size = {aabb[2] * 2, aabb[3] * 2};
+    render_lines_rect(RENDER_LAYER_DEBUG, &aabb[0], size, color);
+};
+
+void render_debug_circle(vec2 center, f32 radius, vec4 color) {
+    Line_Vertex *vertices = render_lines_reserve(RENDER_LAYER_DEBUG, RENDER_DEBUG_CIRCLE_SEGMENTS * 2);
+
+    f32 step = RENDER_DEBUG_TAU / RENDER_DEBUG_CIRCLE_SEGMENTS;
+    f32 x = center[0] + radius;
+    f32 y = center[1];
+
+    for (u32 i = 1; i <= RENDER_DEBUG_CIRCLE_SEGMENTS; ++i) {
+        f32 next_x = center[0] + cosf(step * i) * radius;
+        f32 next_y = center[1] + sinf(step * i) * radius;
+
+        line_vertex(&vertices[0], x, y, color);
+        line_vertex(&vertices[1], next_x, next_y, color);
+        vertices += 2;
+
+        x = next_x;
+        y = next_y;
+    };
+};
@@ -40,137 +40,109 @@ SDL_Window *render_init_window(u32 width, u32 height) {
 };
 
 
-void render_init_shaders(u32 *shader_default, u32 *shader_batch, u32 *shader_rounded, f32 render_width, f32 render_height) {
+void render_init_shaders(Shader *shader_line, Shader *shader_batch, Shader *shader_rounded, f32 render_width, f32 render_height) {
     static mat4x4 projection;
-    *shader_default = render_shader_create("./shaders/default.vert", "./shaders/default.frag");
+    *shader_line = render_shader_create("./shaders/line.vert", "./shaders/line.frag");
     *shader_batch = render_shader_create("./shaders/batch_quad.vert", "./shaders/batch_quad.frag");
     *shader_rounded = render_shader_create("./shaders/rounded_quad.vert", "./shaders/rounded_quad.frag");
 
     mat4x4_ortho(projection, 0, render_width, 0, render_height, -2, 2);
-    
-    glUseProgram(*shader_default);
-    glUniformMatrix4fv(
-        glGetUniformLocation(*shader_default, "projection"),
-        1,
-        GL_FALSE,
-        &projection[0][0]
-    );
-
-    glUseProgram(*shader_batch);
-    glUniformMatrix4fv(
-        glGetUniformLocation(*shader_batch, "projection"),
-        1,
-        GL_FALSE,
-        &projection[0][0]
-    );
-
-    glUseProgram(*shader_rounded);
-    glUniformMatrix4fv(
-        glGetUniformLocation(*shader_rounded, "projection"),
-        1,
-        GL_FALSE,
-        &projection[0][0]
-    );
-}
-
-void render_init_color_texture(u32 *texture) {
-    glGenTextures(1, texture);
-    glBindTexture(GL_TEXTURE_2D, *texture);
 
-    u8 solid_white[4] = {255, 255, 255, 255};
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, solid_white);
-
-    glBindTexture(GL_TEXTURE_2D, 0);
-}
-
-void render_init_quad(u32 *vao, u32 *vbo, u32 *ebo) {
-    
-    //    x,    y, z, u, v,
-    f32 vertices[] = {
-        0.5,  0.5, 0, 0, 0,
-        0.5, -0.5, 0, 0, 1,
-       -0.5, -0.5, 0, 1, 1,
-       -0.5,  0.5, 0, 1, 0
+    Shader *shaders[] = {shader_line, shader_batch, shader_rounded};
+    for (u32 i = 0; i < 3; ++i) {
+        glUseProgram(shaders[i]->program);
+        glUniformMatrix4fv(shaders[i]->uniforms[SHADER_UNIFORM_PROJECTION], 1, GL_FALSE, &projection[0][0]);
     };
+}
 
-    u32 indices[] = {
-      0, 1, 3,
-      1, 2, 3   
-    };
+void render_init_lines(u32 *vao, Vertex_Stream *stream) {
     glGenVertexArrays(1, vao);
-    glGenBuffers(1, vbo);
-    glGenBuffers(1, ebo);
-
     glBindVertexArray(*vao);
 
-    glBindBuffer(GL_ARRAY_BUFFER, *vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    render_stream_init(stream, sizeof(Line_Vertex), RENDER_STREAM_LINE_VERTICES);
 
-    // xyz
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(f32), NULL);
+    // [x, y], [r, g, b, a]
     glEnableVertexAttribArray(0);
-
-    // uv
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(f32), (void*)(3 * sizeof(f32)));
-    glad_glEnableVertexAttribArray(1);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Line_Vertex), (void*)offsetof(Line_Vertex, position));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Line_Vertex), (void*)offsetof(Line_Vertex, color));
 
     glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 };
 
 
-void render_init_line(u32 *vao, u32 *vbo) {
+// Points the sprite attributes of the bound VAO at the stream, starting at
+// instance `first`. Without base instance draws this is redone per range.
+void render_init_sprite_attributes(u32 first) {
+    usize offset = (usize)first * sizeof(Sprite_Instance);
+
+    // [x, y], [w, h], [u0, v0, u1, v1], [r, g, b, a], layer
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Sprite_Instance), (void*)(offset + offsetof(Sprite_Instance, position)));
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Sprite_Instance), (void*)(offset + offsetof(Sprite_Instance, size)));
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(Sprite_Instance), (void*)(offset + offsetof(Sprite_Instance, uvs)));
+    glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Sprite_Instance), (void*)(offset + offsetof(Sprite_Instance, color)));
+    glVertexAttribIPointer(4, 1, GL_UNSIGNED_INT, sizeof(Sprite_Instance), (void*)(offset + offsetof(Sprite_Instance, layer)));
+};
+
+void render_init_batch_sprites(u32 *vao, Vertex_Stream *stream) {
     glGenVertexArrays(1, vao);
     glBindVertexArray(*vao);
 
-    glGenBuffers(1, vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, *vbo);
-    glBufferData(GL_ARRAY_BUFFER, 6 * sizeof(f32), NULL, GL_DYNAMIC_DRAW);
+    render_stream_init(stream, sizeof(Sprite_Instance), RENDER_STREAM_SPRITES);
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(f32), NULL);
-    glEnableVertexAttribArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    for (u32 i = 0; i < 5; ++i) {
+        glEnableVertexAttribArray(i);
+        glVertexAttribDivisor(i, 1);
+    };
+    render_init_sprite_attributes(0);
 
     glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 };
 
 
-void render_init_batch_quads(u32 *vao, u32 *vbo, u32 *ebo) {
+// Sprites that stay in their own buffer, drawn with the batch shader.
+void render_init_static_sprites(u32 *vao, Static_Sprites *sprites) {
     glGenVertexArrays(1, vao);
     glBindVertexArray(*vao);
 
-    u32 indices[MAX_BATCH_ELEMENTS];
+    render_static_init(sprites);
 
-    for (u32 i = 0, offset = 0; i < MAX_BATCH_ELEMENTS; i += 6, offset += 4) {
-        indices[i + 0] = offset + 0;
-        indices[i + 1] = offset + 1;
-        indices[i + 2] = offset + 2;
-        indices[i + 3] = offset + 2;
-        indices[i + 4] = offset + 3;
-        indices[i + 5] = offset + 0;
+    for (u32 i = 0; i < 5; ++i) {
+        glEnableVertexAttribArray(i);
+        glVertexAttribDivisor(i, 1);
     };
+    render_init_sprite_attributes(0);
 
-    glGenBuffers(1, vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, *vbo);
-    glBufferData(GL_ARRAY_BUFFER, MAX_BATCH_VERTICES * sizeof(Batch_Vertex), NULL, GL_DYNAMIC_DRAW);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+};
 
-    // [x, y], [u, v], [r, g, b, a]
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Batch_Vertex), (void*)offsetof(Batch_Vertex, position));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Batch_Vertex), (void*)offsetof(Batch_Vertex, uvs));
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(Batch_Vertex), (void*)offsetof(Batch_Vertex, color));
-    // glVertexAttribPointer(3, 1, GL_INT, GL_FALSE, sizeof(Batch_Vertex), (void*)offsetof(Batch_Vertex, border_radius));
+// Points the rounded quad attributes of the bound VAO at the stream,
+// starting at instance `first`, as render_init_sprite_attributes does.
+void render_init_rounded_attributes(u32 first) {
+    usize offset = (usize)first * sizeof(Rounded_Quad);
 
-    glGenBuffers(1, ebo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, MAX_BATCH_ELEMENTS * sizeof(u32), indices, GL_STATIC_DRAW);
+    // [x, y], [w, h], [r, g, b, a], radius
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Rounded_Quad), (void*)(offset + offsetof(Rounded_Quad, position)));
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Rounded_Quad), (void*)(offset + offsetof(Rounded_Quad, size)));
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Rounded_Quad), (void*)(offset + offsetof(Rounded_Quad, color)));
+    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(Rounded_Quad), (void*)(offset + offsetof(Rounded_Quad, border_radius)));
+};
+
+void render_init_rounded_quads(u32 *vao, Vertex_Stream *stream) {
+    glGenVertexArrays(1, vao);
+    glBindVertexArray(*vao);
+
+    render_stream_init(stream, sizeof(Rounded_Quad), RENDER_STREAM_ROUNDED_QUADS);
+
+    for (u32 i = 0; i < 4; ++i) {
+        glEnableVertexAttribArray(i);
+        glVertexAttribDivisor(i, 1);
+    };
+    render_init_rounded_attributes(0);
 
     glBindVertexArray(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-};
\ No newline at end of file
+};
@@ -1,17 +1,157 @@
 #pragma once
 
+#include <glad/glad.h>
 #include <SDL2/SDL.h>
 
 #include "../types.h"
 
 #include "render.h"
 
+// Frames the GPU may still be reading while the next one is written.
+#define RENDER_STREAM_FRAMES 3
+#define RENDER_STREAM_SPRITES (1 << 17)
+#define RENDER_STREAM_LINE_VERTICES (1 << 17)
+#define RENDER_STREAM_ROUNDED_QUADS (1 << 14)
 
+// Ring of RENDER_STREAM_FRAMES equal parts that vertices are written into
+// directly. A frame only reuses its part once the fence placed after the
+// draws that last read it has passed.
+typedef struct vertex_stream {
+    u32 vbo;
+    u32 vertex_size;
+    u32 frame_vertices;
+    u32 frame;
+    u32 used;
+    // The whole buffer while it is persistently mapped, and the current
+    // frame's part while it is open for writing.
+    u8 *mapped;
+    u8 *frame_memory;
+    GLsync fences[RENDER_STREAM_FRAMES];
+    // Time spent waiting on fences, mapping and flushing.
+    u64 upload_ticks;
+    bool is_persistent;
+    bool is_open;
+} Vertex_Stream;
+
+// Sprites kept on the GPU from frame to frame, for geometry that rarely
+// changes. Writes go to the copy in memory and mark the range they touch;
+// render_static_upload sends only that range, or everything once the
+// buffer has to grow.
+typedef struct static_sprites {
+    u32 vbo;
+    Sprite_Instance *sprites;
+    u32 count;
+    u32 capacity;
+    u32 buffer_capacity;
+    u32 dirty_first;
+    u32 dirty_last;
+} Static_Sprites;
+
+// Layers of the sprite atlas are square, and are added as they fill up.
+#define RENDER_ATLAS_SIZE 1024
+#define RENDER_ATLAS_MAX_LAYERS 16
+
+// Top edge of the packed area over [x, x + width).
+typedef struct skyline_node {
+    u32 x;
+    u32 y;
+    u32 width;
+} Skyline_Node;
+
+// Skyline nodes ordered by x, together covering the whole layer width.
+typedef struct atlas_layer {
+    Skyline_Node *nodes;
+    u32 node_count;
+} Atlas_Layer;
+
+// Array texture every sprite sheet is packed into, so all batched sprites
+// share one texture. The pixels are kept to respecify the texture when a
+// layer is added.
+typedef struct texture_atlas {
+    u32 texture_id;
+    u32 layer_count;
+    Atlas_Layer layers[RENDER_ATLAS_MAX_LAYERS];
+    u8 *pixels;
+    u64 used_area;
+} Texture_Atlas;
+
+// End of a line in the line stream, drawn as GL_LINES.
+typedef struct line_vertex {
+    vec2 position;
+    u8 color[4];
+} Line_Vertex;
+
+// Sort key of a queued draw, compared as one integer. The layer takes the
+// top byte. State-sorted layers follow it with the draw state and then the
+// submission sequence; sequential layers with the sequence and then the
+// state. The state is blend, shader and texture.
+#define RENDER_KEY_LAYER_SHIFT 56
+#define RENDER_KEY_BLEND_SHIFT 22
+#define RENDER_KEY_SHADER_SHIFT 18
+#define RENDER_KEY_TEXTURE_MASK 0x3FFFFu
+
+// Uniforms the shaders use, looked up once when a shader is created. A
+// shader without one keeps -1 in its slot, which glUniform calls ignore.
+typedef enum shader_uniform {
+    SHADER_UNIFORM_PROJECTION,
+    SHADER_UNIFORM_COUNT,
+} Shader_Uniform;
+
+typedef struct shader {
+    u32 program;
+    i32 uniforms[SHADER_UNIFORM_COUNT];
+} Shader;
+
+// GL state as the renderer last set it, so binding what is already bound
+// costs no GL call. Counts the calls issued and skipped since the reset.
+typedef struct render_state {
+    u32 program;
+    u32 vao;
+    u32 texture_2d;
+    u32 texture_array;
+    u32 blend_source;
+    u32 blend_destination;
+    u32 issued;
+    u32 skipped;
+} Render_State;
+
+typedef struct render_sort_item {
+    u64 key;
+    u32 index;
+} Render_Sort_Item;
 
 SDL_Window *render_init_window(u32 width, u32 height);
-void render_init_quad(u32 *vao, u32 *vbo, u32 *ebo);
-void render_init_color_texture(u32 *texture);
-void render_init_shaders(u32 *shader_default, u32 *shader_batch, u32 *shader_rounded, f32 render_width, f32 render_height);
-void render_init_batch_quads(u32 *vao, u32 *vbo, u32 *ebo);
-void render_init_line(u32 *vao, u32 *vbo);
-u32 render_shader_create(const char *path_vert, const char *path_frag);
+void render_init_shaders(Shader *shader_line, Shader *shader_batch, Shader *shader_rounded, f32 render_width, f32 render_height);
+void render_init_batch_sprites(u32 *vao, Vertex_Stream *stream);
+void render_init_sprite_attributes(u32 first);
+void render_init_lines(u32 *vao, Vertex_Stream *stream);
+void render_init_rounded_quads(u32 *vao, Vertex_Stream *stream);
+void render_init_rounded_attributes(u32 first);
+void render_init_static_sprites(u32 *vao, Static_Sprites *sprites);
+Shader render_shader_create(const char *path_vert, const char *path_frag);
+
+void render_state_reset(Render_State *state);
+void render_state_use_shader(Render_State *state, Shader *shader);
+void render_state_bind_vao(Render_State *state, u32 vao);
+void render_state_bind_texture(Render_State *state, u32 target, u32 texture);
+void render_state_blend(Render_State *state, u32 source, u32 destination);
+
+void render_stream_init(Vertex_Stream *stream, u32 vertex_size, u32 frame_vertices);
+void *render_stream_reserve(Vertex_Stream *stream, u32 count, u32 *base_vertex);
+void render_stream_submit(Vertex_Stream *stream);
+void render_stream_end_frame(Vertex_Stream *stream);
+
+void render_static_init(Static_Sprites *sprites);
+void render_static_resize(Static_Sprites *sprites, u32 count);
+Sprite_Instance *render_static_write(Static_Sprites *sprites, u32 index);
+void render_static_upload(Static_Sprites *sprites);
+
+void render_atlas_init(Texture_Atlas *atlas);
+Atlas_Region render_atlas_add(Texture_Atlas *atlas, u8 *pixels, u32 width, u32 height);
+f32 render_atlas_occupancy(Texture_Atlas *atlas);
+
+Render_Sort_Item *render_queue_sort(Render_Sort_Item *items, Render_Sort_Item *scratch, u32 count);
+
+Line_Vertex *render_lines_reserve(Render_Layer layer, u32 count);
+void render_lines_segment(Render_Layer layer, vec2 start, vec2 end, vec4 color);
+void render_lines_rect(Render_Layer layer, vec2 position, vec2 size, vec4 color);
@@ -0,0 +1,52 @@
+#include <string.h>
+
+#include "../util/util.h"
+#include "render_internal.h"
+
+// Stable LSD radix sort on the key, a byte per pass. Passes over a byte
+// every key shares are skipped, which is most of them in a typical frame.
+// Returns whichever of the two buffers ends up holding the sorted items.
+Render_Sort_Item *render_queue_sort(Render_Sort_Item *items, Render_Sort_Item *scratch, u32 count) {
+    if (count < 2) {
+        return items;
+    };
+
+    u32 histograms[8][256];
+    memset(histograms, 0, sizeof(histograms));
+
+    for (u32 i = 0; i < count; ++i) {
+        u64 key = items[i].key;
+        for (u32 digit = 0; digit < 8; ++digit) {
+            ++histograms[digit][(key >> (digit * 8)) & 0xFF];
+        };
+    };
+
+    Render_Sort_Item *src = items;
+    Render_Sort_Item *dst = scratch;
+
+    for (u32 digit = 0; digit < 8; ++digit) {
+        u32 *histogram = histograms[digit];
+        u32 shift = digit * 8;
+
+        if (histogram[(src[0].key >> shift) & 0xFF] == count) {
+            continue;
+        };
+
+        u32 offset = 0;
+        for (u32 i = 0; i < 256; ++i) {
+            u32 bucket_count = histogram[i];
+            histogram[i] = offset;
+            offset += bucket_count;
+        };
+
+        for (u32 i = 0; i < count; ++i) {
+            dst[histogram[(src[i].key >> shift) & 0xFF]++] = src[i];
+        };
+
+        Render_Sort_Item *swap = src;
+        src = dst;
+        dst = swap;
+    };
+
+    return src;
+};
@@ -0,0 +1,61 @@
+#include <glad/glad.h>
+#include <string.h>
+
+#include "../util/util.h"
+#include "render_internal.h"
+
+// Forgets what is bound, so the next call of each kind is issued whatever
+// other code bound in the meantime, and zeroes the counters.
+void render_state_reset(Render_State *state) {
+    memset(state, 0xFF, sizeof(*state));
+    state->issued = 0;
+    state->skipped = 0;
+};
+
+void render_state_use_shader(Render_State *state, Shader *shader) {
+    if (state->program == shader->program) {
+        ++state->skipped;
+        return;
+    };
+
+    glUseProgram(shader->program);
+    state->program = shader->program;
+    ++state->issued;
+};
+
+void render_state_bind_vao(Render_State *state, u32 vao) {
+    if (state->vao == vao) {
+        ++state->skipped;
+        return;
+    };
+
+    glBindVertexArray(vao);
+    state->vao = vao;
+    ++state->issued;
+};
+
+// Only texture unit 0 is used. Its 2D and array bindings are separate, so
+// each target is tracked on its own.
+void render_state_bind_texture(Render_State *state, u32 target, u32 texture) {
+    u32 *bound = target == GL_TEXTURE_2D_ARRAY ? &state->texture_array : &state->texture_2d;
+    if (*bound == texture) {
+        ++state->skipped;
+        return;
+    };
+
+    glBindTexture(target, texture);
+    *bound = texture;
+    ++state->issued;
+};
+
+void render_state_blend(Render_State *state, u32 source, u32 destination) {
+    if (state->blend_source == source && state->blend_destination == destination) {
+        ++state->skipped;
+        return;
+    };
+
+    glBlendFunc(source, destination);
+    state->blend_source = source;
+    state->blend_destination = destination;
+    ++state->issued;
+};
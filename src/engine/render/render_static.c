@@ -0,0 +1,82 @@
+#include <glad/glad.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../util/util.h"
+#include "render_internal.h"
+
+#define RENDER_STATIC_INITIAL_CAPACITY 1024
+
+// Creates the buffer and leaves it bound to GL_ARRAY_BUFFER, so the caller
+// can point the bound VAO at it.
+void render_static_init(Static_Sprites *sprites) {
+    *sprites = (Static_Sprites){0};
+
+    glGenBuffers(1, &sprites->vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, sprites->vbo);
+};
+
+// Sprites past the old count are zeroed, which draws nothing until they are
+// written. Shrinking keeps the memory.
+void render_static_resize(Static_Sprites *sprites, u32 count) {
+    if (count > sprites->capacity) {
+        u32 capacity = sprites->capacity ? sprites->capacity : RENDER_STATIC_INITIAL_CAPACITY;
+        while (capacity < count) {
+            capacity *= 2;
+        };
+
+        Sprite_Instance *memory = realloc(sprites->sprites, (usize)capacity * sizeof(Sprite_Instance));
+        if (!memory) {
+            ERROR_EXIT("Could not allocate memory for static sprites\n");
+        };
+        sprites->sprites = memory;
+        sprites->capacity = capacity;
+    };
+
+    if (count > sprites->count) {
+        memset(&sprites->sprites[sprites->count], 0, (usize)(count - sprites->count) * sizeof(Sprite_Instance));
+        render_static_write(sprites, sprites->count);
+        render_static_write(sprites, count - 1);
+    };
+
+    sprites->count = count;
+};
+
+Sprite_Instance *render_static_write(Static_Sprites *sprites, u32 index) {
+    if (sprites->dirty_first >= sprites->dirty_last) {
+        sprites->dirty_first = index;
+        sprites->dirty_last = index + 1;
+    } else if (index < sprites->dirty_first) {
+        sprites->dirty_first = index;
+    } else if (index >= sprites->dirty_last) {
+        sprites->dirty_last = index + 1;
+    };
+
+    return &sprites->sprites[index];
+};
+
+void render_static_upload(Static_Sprites *sprites) {
+    if (sprites->dirty_first >= sprites->dirty_last) {
+        return;
+    };
+
+    glBindBuffer(GL_ARRAY_BUFFER, sprites->vbo);
+
+    if (sprites->buffer_capacity < sprites->capacity) {
+        glBufferData(GL_ARRAY_BUFFER, (usize)sprites->capacity * sizeof(Sprite_Instance), sprites->sprites, GL_DYNAMIC_DRAW);
+        sprites->buffer_capacity = sprites->capacity;
+    } else {
+        u32 last = sprites->dirty_last < sprites->count ? sprites->dirty_last : sprites->count;
+        if (last > sprites->dirty_first) {
+            glBufferSubData(
+                GL_ARRAY_BUFFER,
+                (usize)sprites->dirty_first * sizeof(Sprite_Instance),
+                (usize)(last - sprites->dirty_first) * sizeof(Sprite_Instance),
+                &sprites->sprites[sprites->dirty_first]
+            );
+        };
+    };
+
+    sprites->dirty_first = 0;
+    sprites->dirty_last = 0;
+};
@@ -0,0 +1,117 @@
+#include <glad/glad.h>
+
+#include "../util/util.h"
+#include "render_internal.h"
+
+// Long enough for any frame the GPU could still be drawing.
+#define RENDER_STREAM_WAIT_NS 1000000000ull
+
+// Creates the buffer on the bound GL_ARRAY_BUFFER target. With buffer
+// storage the whole ring stays mapped for good; otherwise each frame's part
+// is mapped unsynchronized when the frame starts writing, which the fences
+// make safe.
+void render_stream_init(Vertex_Stream *stream, u32 vertex_size, u32 frame_vertices) {
+    *stream = (Vertex_Stream){
+        .vertex_size = vertex_size,
+        .frame_vertices = frame_vertices,
+        .is_persistent = GLAD_GL_VERSION_4_4 != 0,
+    };
+
+    usize size = (usize)vertex_size * frame_vertices * RENDER_STREAM_FRAMES;
+
+    glGenBuffers(1, &stream->vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, stream->vbo);
+
+    if (stream->is_persistent) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, size, NULL, flags);
+        stream->mapped = glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+
+        if (!stream->mapped) {
+            ERROR_EXIT("Could not map vertex stream\n");
+        };
+    } else {
+        glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+    };
+};
+
+static void stream_open(Vertex_Stream *stream) {
+    u64 start = SDL_GetPerformanceCounter();
+    GLsync fence = stream->fences[stream->frame];
+
+    if (fence) {
+        GLenum result;
+        do {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, RENDER_STREAM_WAIT_NS);
+        } while (result == GL_TIMEOUT_EXPIRED);
+
+        glDeleteSync(fence);
+        stream->fences[stream->frame] = NULL;
+    };
+
+    if (!stream->is_persistent) {
+        usize frame_size = (usize)stream->vertex_size * stream->frame_vertices;
+
+        glBindBuffer(GL_ARRAY_BUFFER, stream->vbo);
+        stream->frame_memory = glMapBufferRange(
+            GL_ARRAY_BUFFER, frame_size * stream->frame, frame_size,
+            GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT
+        );
+
+        if (!stream->frame_memory) {
+            ERROR_EXIT("Could not map vertex stream\n");
+        };
+    } else {
+        stream->frame_memory = stream->mapped + (usize)stream->vertex_size * stream->frame_vertices * stream->frame;
+    };
+
+    stream->used = 0;
+    stream->is_open = true;
+    stream->upload_ticks += SDL_GetPerformanceCounter() - start;
+};
+
+// Returns where to write `count` vertices this frame, and in base_vertex
+// the index of the first one in the whole buffer.
+void *render_stream_reserve(Vertex_Stream *stream, u32 count, u32 *base_vertex) {
+    if (!stream->is_open) {
+        stream_open(stream);
+    };
+
+    if (stream->used + count > stream->frame_vertices) {
+        ERROR_EXIT("Exceeded vertex stream capacity of %u vertices per frame.\n", stream->frame_vertices);
+    };
+
+    void *memory = stream->frame_memory + (usize)stream->vertex_size * stream->used;
+    *base_vertex = stream->frame * stream->frame_vertices + stream->used;
+    stream->used += count;
+
+    return memory;
+};
+
+// Hands what was written this frame to GL. Call before drawing from it.
+void render_stream_submit(Vertex_Stream *stream) {
+    if (!stream->is_open || stream->is_persistent) {
+        return;
+    };
+
+    u64 start = SDL_GetPerformanceCounter();
+
+    glBindBuffer(GL_ARRAY_BUFFER, stream->vbo);
+    glFlushMappedBufferRange(GL_ARRAY_BUFFER, 0, (usize)stream->vertex_size * stream->used);
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+    stream->frame_memory = NULL;
+
+    stream->upload_ticks += SDL_GetPerformanceCounter() - start;
+};
+
+// Fences the frame's draws and moves on to the next part of the ring. Call
+// after the last draw that reads this frame's vertices.
+void render_stream_end_frame(Vertex_Stream *stream) {
+    if (!stream->is_open) {
+        return;
+    };
+
+    stream->fences[stream->frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    stream->frame = (stream->frame + 1) % RENDER_STREAM_FRAMES;
+    stream->is_open = false;
+};
@@ -5,7 +5,11 @@
 #include "../io/io.h"
 #include "render_internal.h"
 
-u32 render_shader_create(const char *path_vert, const char *path_frag) {
+static const char *uniform_names[SHADER_UNIFORM_COUNT] = {
+    [SHADER_UNIFORM_PROJECTION] = "projection",
+};
+
+Shader render_shader_create(const char *path_vert, const char *path_frag) {
     int success;
     char log[512];
         
@@ -54,5 +58,10 @@ u32 render_shader_create(const char *path_vert, const char *path_frag) {
     free(file_vertex.data);
     free(file_fragment.data);
 
-    return shader;
+    Shader result = {.program = shader};
+    for (u32 i = 0; i < SHADER_UNIFORM_COUNT; ++i) {
+        result.uniforms[i] = glGetUniformLocation(shader, uniform_names[i]);
+    };
+
+    return result;
 };
\ No newline at end of file
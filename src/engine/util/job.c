@@ -0,0 +1,114 @@
+#include <stdlib.h>
+#include "util.h"
+#include "job.h"
+
+// Takes jobs from the current batch until none are left. Called with the
+// mutex held and returns with it held.
+static void run_jobs(Job_Pool *pool) {
+    while (pool->next_job < pool->job_count) {
+        u32 job_index = pool->next_job++;
+        Job_Fn fn = pool->fn;
+        void *context = pool->context;
+
+        pthread_mutex_unlock(&pool->mutex);
+        fn(context, job_index);
+        pthread_mutex_lock(&pool->mutex);
+
+        if (++pool->jobs_done == pool->job_count) {
+            pthread_cond_signal(&pool->work_done);
+        };
+    };
+};
+
+static void *worker_main(void *argument) {
+    Job_Pool *pool = argument;
+    u32 batch = 0;
+
+    pthread_mutex_lock(&pool->mutex);
+
+    for (;;) {
+        while (pool->batch == batch && !pool->is_shutting_down) {
+            pthread_cond_wait(&pool->work_ready, &pool->mutex);
+        };
+
+        if (pool->is_shutting_down) {
+            break;
+        };
+
+        batch = pool->batch;
+        run_jobs(pool);
+    };
+
+    pthread_mutex_unlock(&pool->mutex);
+    return NULL;
+};
+
+Job_Pool *job_pool_create(u32 worker_count) {
+    Job_Pool *pool = calloc(1, sizeof(Job_Pool));
+
+    if (!pool) {
+        ERROR_RETURN(NULL, "Could not allocate memory for Job_Pool\n");
+    };
+
+    pool->thread_count = worker_count > 1 ? worker_count - 1 : 0;
+    pool->threads = calloc(pool->thread_count > 0 ? pool->thread_count : 1, sizeof(pthread_t));
+
+    if (!pool->threads) {
+        ERROR_RETURN(NULL, "Could not allocate memory for Job_Pool threads\n");
+    };
+
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->work_done, NULL);
+
+    for (u32 i = 0; i < pool->thread_count; ++i) {
+        if (pthread_create(&pool->threads[i], NULL, worker_main, pool) != 0) {
+            ERROR_EXIT("Could not create job pool thread\n");
+        };
+    };
+
+    return pool;
+};
+
+// Runs fn(context, i) for every i below job_count and returns once all of
+// them have finished. Jobs may run in any order and on any thread.
+void job_pool_run(Job_Pool *pool, Job_Fn fn, void *context, u32 job_count) {
+    if (job_count == 0) {
+        return;
+    };
+
+    pthread_mutex_lock(&pool->mutex);
+
+    pool->fn = fn;
+    pool->context = context;
+    pool->job_count = job_count;
+    pool->next_job = 0;
+    pool->jobs_done = 0;
+    ++pool->batch;
+
+    pthread_cond_broadcast(&pool->work_ready);
+    run_jobs(pool);
+
+    while (pool->jobs_done < pool->job_count) {
+        pthread_cond_wait(&pool->work_done, &pool->mutex);
+    };
+
+    pthread_mutex_unlock(&pool->mutex);
+};
+
+void job_pool_destroy(Job_Pool *pool) {
+    pthread_mutex_lock(&pool->mutex);
+    pool->is_shutting_down = true;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (u32 i = 0; i < pool->thread_count; ++i) {
+        pthread_join(pool->threads[i], NULL);
+    };
+
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_cond_destroy(&pool->work_done);
+    free(pool->threads);
+    free(pool);
+};
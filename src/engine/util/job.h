@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "../types.h"
+
+typedef void (*Job_Fn)(void *context, u32 job_index);
+
+// Fixed set of worker threads that run batches of indexed jobs. The thread
+// calling job_pool_run works on the batch too, so a pool of one worker
+// runs everything on the caller.
+typedef struct job_pool {
+    pthread_t *threads;
+    u32 thread_count;
+    pthread_mutex_t mutex;
+    pthread_cond_t work_ready;
+    pthread_cond_t work_done;
+    Job_Fn fn;
+    void *context;
+    u32 job_count;
+    u32 next_job;
+    u32 jobs_done;
+    u32 batch;
+    bool is_shutting_down;
+} Job_Pool;
+
+Job_Pool *job_pool_create(u32 worker_count);
+void job_pool_run(Job_Pool *pool, Job_Fn fn, void *context, u32 job_count);
+void job_pool_destroy(Job_Pool *pool);
@@ -0,0 +1,127 @@
+#include <stdlib.h>
+#include <string.h>
+#include "slot_map.h"
+
+static usize make_handle(u32 index, u32 generation) {
+    return ((usize)generation << SLOT_MAP_INDEX_BITS) | index;
+};
+
+Slot_Map *slot_map_create(usize item_size, usize initial_capacity) {
+    Slot_Map *map = malloc(sizeof(Slot_Map));
+
+    if (!map) {
+        ERROR_RETURN(NULL, "Could not allocate memory for Slot_Map\n");
+    };
+
+    map->items = array_list_create(item_size, initial_capacity);
+    map->slots = array_list_create(sizeof(Slot), initial_capacity);
+    map->free_head = SLOT_MAP_NONE;
+    map->count = 0;
+
+    if (!map->items || !map->slots) {
+        ERROR_RETURN(NULL, "Could not allocate memory for Slot_Map\n");
+    };
+
+    return map;
+};
+
+usize slot_map_insert(Slot_Map *map, void *item) {
+    u32 index = map->free_head;
+
+    if (index == SLOT_MAP_NONE) {
+        if (array_list_append(map->items, item) == (usize)-1) {
+            ERROR_RETURN(SLOT_MAP_INVALID, "Could not append item to Slot_Map\n");
+        };
+        if (array_list_append(map->slots, &(Slot){.next_free = SLOT_MAP_NONE}) == (usize)-1) {
+            ERROR_RETURN(SLOT_MAP_INVALID, "Could not append slot to Slot_Map\n");
+        };
+        index = map->items->len - 1;
+    } else {
+        memcpy(array_list_get(map->items, index), item, map->items->item_size);
+    };
+
+    Slot *slot = array_list_get(map->slots, index);
+    map->free_head = slot->next_free;
+    slot->next_free = SLOT_MAP_NONE;
+    ++slot->generation;
+    ++map->count;
+
+    return make_handle(index, slot->generation);
+};
+
+void *slot_map_get(Slot_Map *map, usize handle) {
+    u32 index = slot_map_index(handle);
+
+    if (index >= map->slots->len) {
+        return NULL;
+    };
+
+    Slot *slot = (Slot *)map->slots->items + index;
+
+    if (make_handle(index, slot->generation) != handle || (slot->generation & 1) == 0) {
+        return NULL;
+    };
+
+    return (u8 *)map->items->items + index * map->items->item_size;
+};
+
+u8 slot_map_remove(Slot_Map *map, usize handle) {
+    if (slot_map_get(map, handle) == NULL) {
+        ERROR_RETURN(1, "Stale or invalid Slot_Map handle\n");
+    };
+
+    u32 index = slot_map_index(handle);
+    Slot *slot = array_list_get(map->slots, index);
+
+    ++slot->generation;
+    slot->next_free = map->free_head;
+    map->free_head = index;
+    --map->count;
+
+    return 0;
+};
+
+// Returns NULL for free slots.
+void *slot_map_at(Slot_Map *map, usize index) {
+    if (index >= map->slots->len) {
+        return NULL;
+    };
+
+    Slot *slot = (Slot *)map->slots->items + index;
+
+    if ((slot->generation & 1) == 0) {
+        return NULL;
+    };
+
+    return (u8 *)map->items->items + index * map->items->item_size;
+};
+
+usize slot_map_handle_at(Slot_Map *map, usize index) {
+    if (slot_map_at(map, index) == NULL) {
+        return SLOT_MAP_INVALID;
+    };
+
+    Slot *slot = array_list_get(map->slots, index);
+    return make_handle(index, slot->generation);
+};
+
+// Number of slots, live or free. Bound for iterating with slot_map_at.
+usize slot_map_len(Slot_Map *map) {
+    return map->slots->len;
+};
+
+u32 slot_map_index(usize handle) {
+    return (u32)(handle & SLOT_MAP_NONE);
+};
+
+// Makes dst an exact copy of src, handles included.
+u8 slot_map_copy(Slot_Map *dst, Slot_Map *src) {
+    if (array_list_copy(dst->items, src->items) != 0 || array_list_copy(dst->slots, src->slots) != 0) {
+        ERROR_RETURN(1, "Could not copy Slot_Map\n");
+    };
+
+    dst->free_head = src->free_head;
+    dst->count = src->count;
+
+    return 0;
+};
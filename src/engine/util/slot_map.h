@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "../types.h"
+#include "util.h"
+
+// Handles pack the slot index in the low 32 bits and the slot's generation
+// in the high 32 bits. A handle goes stale as soon as its slot is removed.
+#define SLOT_MAP_INDEX_BITS 32
+#define SLOT_MAP_INVALID ((usize)-1)
+#define SLOT_MAP_NONE ((u32)-1)
+
+// Generation is odd while the slot is live and even while it is free.
+typedef struct slot {
+    u32 generation;
+    u32 next_free;
+} Slot;
+
+// Items live in one Array_List indexed by slot, so iterating 0..len with
+// slot_map_at visits them in memory order. Free slots are chained through
+// their Slot records and reused most recently freed first.
+typedef struct slot_map {
+    Array_List *items;
+    Array_List *slots;
+    u32 free_head;
+    usize count;
+} Slot_Map;
+
+Slot_Map *slot_map_create(usize item_size, usize initial_capacity);
+usize slot_map_insert(Slot_Map *map, void *item);
+void *slot_map_get(Slot_Map *map, usize handle);
+u8 slot_map_remove(Slot_Map *map, usize handle);
+void *slot_map_at(Slot_Map *map, usize index);
+usize slot_map_handle_at(Slot_Map *map, usize index);
+usize slot_map_len(Slot_Map *map);
+u32 slot_map_index(usize handle);
+u8 slot_map_copy(Slot_Map *dst, Slot_Map *src);
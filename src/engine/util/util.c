@@ -65,6 +65,28 @@ u8 array_list_remove(Array_List *list, usize index) {
     return 0;
 };
 
+// Makes dst hold the same items as src. Only allocates when dst is smaller,
+// so copying into the same list every frame settles at no allocations.
+u8 array_list_copy(Array_List *dst, Array_List *src) {
+    if (dst->item_size != src->item_size) {
+        ERROR_RETURN(1, "Array_List item sizes differ\n");
+    };
+
+    if (dst->capacity < src->len) {
+        void *items = realloc(dst->items, src->item_size * src->capacity);
+        if (!items) {
+            ERROR_RETURN(1, "Could not allocate memory for Array_List\n");
+        };
+        dst->items = items;
+        dst->capacity = src->capacity;
+    };
+
+    memcpy(dst->items, src->items, src->len * src->item_size);
+    dst->len = src->len;
+
+    return 0;
+};
+
 char* concat(const char *s1, const char *s2) {
     const size_t len1 = strlen(s1);
     const size_t len2 = strlen(s2);
@@ -33,5 +33,6 @@ Array_List *array_list_create(usize item_size, usize initial_capacity);
 usize array_list_append(Array_List *list, void *item);
 void *array_list_get(Array_List *list, usize index);
 u8 array_list_remove(Array_List *list, usize index);
+u8 array_list_copy(Array_List *dst, Array_List *src);
 char* concat(const char *s1, const char *s2);
 
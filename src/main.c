@@ -11,6 +11,7 @@
 #include "engine/time/time.h"
 #include "engine/physics/physics.h"
 #include "engine/util/util.h"
+#include "engine/util/slot_map.h"
 #include "engine/entity/entity.h"
 #include "engine/render/render.h"
 #include "engine/animation/animation.h"
@@ -58,6 +59,10 @@ static void input_handle(Body *body_player) {
 
 
 void player_on_hit(Body *self, Body *other, Hit hit) {
+    if (hit.event == CONTACT_EVENT_END) {
+        return;
+    };
+
     if (other->collision_layer == COLLISION_LAYER_ENEMY) {
         player_color[0] = 1;
         player_color[2] = 0;
@@ -103,17 +108,12 @@ void enemy_large_on_hit_static(Body *self, Static_Body *other, Hit hit) {
     };
 }
 
-void fire_on_hit(Body *self, Body * other, Hit hit) {
+void fire_on_trigger(Trigger *self, Body *other, Hit hit) {
     if (other->collision_layer == COLLISION_LAYER_ENEMY) {
-        for (usize i = 0; i < entity_count(); ++i) {
-            Entity *entity = entity_get(i);
+        usize entity_id = entity_from_body(hit.other_id);
 
-            if (entity->body_id == hit.other_id) {
-                Body *body = physics_body_get(entity->body_id);
-                body->is_active = false;
-                entity->is_active = false;
-                break;
-            }
+        if (entity_id != SLOT_MAP_INVALID) {
+            entity_destroy(entity_id);
         }
     }
 }
@@ -145,6 +145,7 @@ int main() {
     config_init();
     SDL_Window *window = render_init();
     physics_init();
+    physics_set_fixed_timestep(60, 4);
     entity_init();
     ui_init();
     animation_init();
@@ -174,13 +175,18 @@ int main() {
     global.window.width = width;
     global.window.height = height;
 
+    // Enemies more than a screen away from the player step at a quarter of
+    // the rate, and ones further than two are frozen.
+    physics_lod_set(width, width * 2, 4);
+
     // u32 static_body_a_id = physics_static_body_create((vec2){width * 0.5, height}, (vec2){width, 50}, COLLISION_LAYER_TERRAIN);
     // u32 static_body_b_id = physics_static_body_create((vec2){width - 12.5, height * 0.5}, (vec2){25, height}, COLLISION_LAYER_TERRAIN);
     // u32 static_body_c_id = physics_static_body_create((vec2){width * 0.5, 12.5}, (vec2){width - 50, 50}, COLLISION_LAYER_TERRAIN);
     // u32 static_body_d_id = physics_static_body_create((vec2){12.5, height * 0.5 - 12.5}, (vec2){25, height - 25}, COLLISION_LAYER_TERRAIN);
     // u32 static_body_e_id = physics_static_body_create((vec2){width * 0.5, height * 0.5}, (vec2){62.5, 62.5}, COLLISION_LAYER_TERRAIN);
 
-    usize entity_fire = entity_create((vec2){370, 50}, (vec2){25, 25}, (vec2){0}, 1 , 0, fire_mask, true, fire_on_hit, NULL);
+    usize trigger_fire = physics_trigger_create((vec2){370, 50}, (vec2){25, 25}, fire_mask, fire_on_trigger);
+    physics_trigger_get(trigger_fire)->contact_events = CONTACT_EVENT_BEGIN;
 
     // usize entity_a_id = entity_create((vec2){200, 100}, (vec2){25, 25}, (vec2){900, 0}, 0.4, COLLISION_LAYER_ENEMY, enemy_mask, NULL, enemy_on_hit_static);
     // usize entity_b_id = entity_create((vec2){300, 100}, (vec2){25, 25}, (vec2){900, 0}, 0.4, 0, enemy_mask, NULL, enemy_on_hit_static);
@@ -271,7 +277,8 @@ int main() {
 
         input_update();
         // input_handle(body_player);
-        physics_update();
+        physics_lod_set_focus(&physics_body_get(entity_get(player_id)->body_id)->aabb.position, 1);
+        physics_update(global.time.delta);
 
         animation_update(global.time.delta);
 
@@ -311,7 +318,7 @@ int main() {
         
 
         // for (usize i = 0; i < entity_count(); ++i) {
-        //     Entity *entity = entity_get(i);
+        //     Entity *entity = entity_at(i);
         //     Body *body = physics_body_get(entity->body_id);
 
         //     if (body->is_active) {
@@ -332,7 +339,7 @@ int main() {
         
 
         // for (usize i = 0; i < entity_count(); ++i) {
-        //     Entity *entity = entity_get(i);
+        //     Entity *entity = entity_at(i);
         //     if (!entity->is_active) {
         //         continue;
         //     };